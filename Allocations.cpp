@@ -0,0 +1,53 @@
+#include <new>
+#include <cstdlib>
+#include <atomic>
+
+#include "Allocations.hpp"
+
+static std::atomic<unsigned long long> allocations{ 0 };
+
+unsigned long long allocationCount()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+// The plain forms do the work, the array and sized forms forward to them so every path is counted and freed alike
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (size == 0)
+		size = 1;
+	while (true) {
+		if (void* p = std::malloc(size))
+			return p;
+		std::new_handler handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	::operator delete(p);
+}
+
+void* operator new[](std::size_t size)
+{
+	return ::operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+	::operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	::operator delete(p);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+/* Heap allocation counter
+*
+* Global operator new is replaced to count every allocation made by the process, thread pool workers included.
+* Used to check that layout steps and frames don't allocate once their buffers have grown to size.
+* Background work running at the same time (centrality) is counted too.
+*/
+unsigned long long allocationCount();
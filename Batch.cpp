@@ -0,0 +1,220 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+
+#include "Batch.hpp"
+#include "Graph.hpp"
+#include "Util.hpp"
+#include "ThreadPool.hpp"
+#include "Metrics.hpp"
+
+namespace fs = std::filesystem;
+
+// Limits how many tasks hold a loaded graph at once
+class Slots {
+public:
+	explicit Slots(int count) : free(count) {}
+	void acquire() {
+		unique_lock<mutex> lock(m);
+		released.wait(lock, [this] { return free > 0; });
+		free--;
+	}
+	void release() {
+		{
+			lock_guard<mutex> lock(m);
+			free++;
+		}
+		released.notify_one();
+	}
+private:
+	mutex m;
+	condition_variable released;
+	int free;
+};
+
+static bool isGraphFile(const fs::path& path) {
+	string ext = path.extension().string();
+	transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".gml" || ext == ".txt" || ext == ".edges" || ext == ".el";
+}
+
+static vector<fs::path> listInputs(const string& input) {
+	vector<fs::path> files;
+	if (fs::is_directory(input)) {
+		for (const auto& entry : fs::directory_iterator(input)) {
+			if (entry.is_regular_file() && isGraphFile(entry.path()))
+				files.push_back(entry.path());
+		}
+		sort(files.begin(), files.end());
+	}
+	else {
+		// Manifest, paths relative to the manifest's directory
+		ifstream manifest(input);
+		if (!manifest)
+			throw runtime_error("Can't open " + input);
+		fs::path base = fs::path(input).parent_path();
+		string line;
+		while (getline(manifest, line)) {
+			trim(line);
+			if (line.empty() || line[0] == '#')
+				continue;
+			fs::path p(line);
+			files.push_back(p.is_absolute() ? p : base / p);
+		}
+	}
+	return files;
+}
+
+static Graph loadGraph(const fs::path& path) {
+	if (!fs::exists(path))
+		throw runtime_error("no such file");
+	string ext = path.extension().string();
+	transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	if (ext == ".gml")
+		return Graph::fromGML(path.string());
+	return Graph::fromEdgeList(path.string());
+}
+
+void configureAlgorithm(Graph& G, const string& algorithm, float C) {
+	FruchtermanParams params = calcFruchtParams(G.Nodes().size(), C);
+	if (algorithm == "linlog")
+		G.LinLog(params);
+	else if (algorithm == "fa2")
+		G.ForceAtlas2(params);
+	else if (algorithm == "sgd")
+		G.StressSGD(params);
+	else if (algorithm == "layered" || (algorithm == "auto" && G.IsDirected()))
+		G.Layered(params);
+	else if (algorithm == "tree" || (algorithm == "auto" && G.IsForest()))
+		G.Tree(params, false);
+	else if (algorithm == "radial")
+		G.Tree(params, true);
+	else
+		G.FruchtermanReingold(params);
+}
+
+static void writePositions(const Graph& G, const fs::path& file) {
+	ofstream out(file);
+	if (!out)
+		throw runtime_error("Can't write " + file.string());
+	const auto& nodes = G.Nodes();
+	const auto& positions = G.Positions();
+	// In file order, whatever order the nodes have in memory
+	vector<int> byId(nodes.size());
+	for (int i = 0; i < nodes.size(); ++i)
+		byId[nodes[i].id] = i;
+	for (int i : byId)
+		out << nodes[i].label << ' ' << positions[i].x << ' ' << positions[i].y << '\n';
+}
+
+// Load, lay out and write a single graph, returns time taken in milliseconds
+// With options.metrics the quality of the layout goes to 'metrics'
+static double layoutFile(const fs::path& path, const BatchOptions& options, LayoutMetrics& metrics) {
+	auto start = chrono::steady_clock::now();
+
+	Graph G = loadGraph(path);
+	if (G.Nodes().empty())
+		throw runtime_error("empty graph");
+	G.setSeed(options.seed);
+	G.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+	// After the initial layout, Hilbert order sorts by position
+	if (options.order == "rcm")
+		G.setNodeOrdering(OrderRCM);
+	else if (options.order == "hilbert")
+		G.setNodeOrdering(OrderHilbert);
+	configureAlgorithm(G, options.algorithm, options.C);
+	for (int i = 0; i < options.maxIterations && G.Update(); ++i);
+	writePositions(G, fs::path(options.outputDir) / (path.filename().string() + ".pos"));
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	if (options.metrics)
+		metrics = layoutMetrics(G.Adjacency(), G.Positions());
+	return ms;
+}
+
+static double percentile(vector<double> sorted, double p) {
+	if (sorted.empty())
+		return 0.;
+	int index = max(0, min(int(sorted.size()) - 1, int(ceil(p * sorted.size())) - 1));
+	return sorted[index];
+}
+
+int runBatch(const BatchOptions& options)
+{
+	vector<fs::path> files = listInputs(options.input);
+	fs::create_directories(options.outputDir);
+	cout << "Batch: " << files.size() << " graphs, " << ThreadPool::global().size() << " threads, "
+		<< options.inFlight << " in flight" << endl;
+
+	// Small files are packed so one task lays out several of them in sequence
+	vector<vector<fs::path>> tasks;
+	vector<fs::path> pack;
+	for (const fs::path& file : files) {
+		error_code ec;
+		auto bytes = fs::file_size(file, ec);
+		if (ec || (long long)bytes >= options.smallFileBytes) {
+			tasks.push_back({ file });
+			continue;
+		}
+		pack.push_back(file);
+		if (pack.size() == options.packSize) {
+			tasks.push_back(pack);
+			pack.clear();
+		}
+	}
+	if (!pack.empty())
+		tasks.push_back(pack);
+
+	mutex resultMutex;
+	vector<double> times;
+	ofstream metricsFile;
+	if (options.metrics) {
+		metricsFile.open(fs::path(options.outputDir) / "metrics.csv");
+		metricsFile << "graph,time_ms,crossings,stress,neighbourhood,angular_resolution,edge_length_variance\n";
+	}
+	int failed = 0;
+	Slots slots(max(1, options.inFlight));
+
+	auto start = chrono::steady_clock::now();
+	{
+		TaskGroup group;
+		for (auto& task : tasks) {
+			// Every task holds at most one loaded graph at a time
+			slots.acquire();
+			group.run([&, task]() {
+				for (const fs::path& file : task) {
+					try {
+						LayoutMetrics metrics;
+						double ms = layoutFile(file, options, metrics);
+						lock_guard<mutex> lock(resultMutex);
+						times.push_back(ms);
+						if (options.metrics) {
+							metricsFile << file.filename().string() << ',' << ms << ',' << metrics.crossings << ',' << metrics.stress << ','
+								<< metrics.neighbourhood << ',' << metrics.angularResolution << ',' << metrics.edgeLengthVariance << '\n';
+						}
+					}
+					catch (const exception& e) {
+						lock_guard<mutex> lock(resultMutex);
+						cout << "Failed " << file.string() << ": " << e.what() << endl;
+						failed++;
+					}
+				}
+				slots.release();
+			});
+		}
+		group.wait();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	sort(times.begin(), times.end());
+	cout << "Laid out " << times.size() << " graphs (" << failed << " failed) in " << seconds << " s" << endl;
+	cout << "Throughput: " << (seconds > 0 ? times.size() / seconds : 0.) << " graphs/s" << endl;
+	cout << "Time per graph: p50 " << percentile(times, 0.5) << " ms, p99 " << percentile(times, 0.99) << " ms" << endl;
+	return failed;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+using namespace std;
+
+struct BatchOptions {
+	// directory with graph files, or a manifest listing one file per line
+	string input;
+	// positions are written to <outputDir>/<file name>.pos
+	string outputDir = "layouts";
+	// at most this many graphs are loaded at the same time
+	int inFlight = 16;
+	// files smaller than this are packed together into one task
+	long long smallFileBytes = 64 * 1024;
+	// number of small files per task
+	int packSize = 8;
+	// "fr", "linlog", "fa2", "sgd", "tree", "radial", "layered" or "auto" (layered for directed graphs, tree for forests, fr otherwise)
+	string algorithm = "fr";
+	// algorithm parameter C
+	float C = 0.7f;
+	int maxIterations = 10000;
+	// seed of the random initial layout, the same seed gives the same layouts
+	unsigned seed = 0;
+	// memory order of the nodes: "file", "rcm" or "hilbert", see Graph::setNodeOrdering()
+	string order = "file";
+	// also write layout quality of every graph to <outputDir>/metrics.csv
+	bool metrics = false;
+};
+
+/* Batch layout
+*
+* Lays out every GML (.gml) or edge list (.txt, .edges, .el) file of the input on the global work-stealing pool.
+* Large graphs parallelize their own steps on the same pool, small files are packed into shared tasks.
+* Prints throughput (graphs per second) and p50/p99 time per graph, returns number of failed graphs.
+* Metrics are computed after the layout is written and are not part of the time per graph.
+*/
+int runBatch(const BatchOptions& options);
+
+class Graph;
+// Select an algorithm by its name in BatchOptions::algorithm, with parameters for the size of G
+void configureAlgorithm(Graph& G, const string& algorithm, float C);
@@ -0,0 +1,428 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <filesystem>
+#include <numeric>
+#include <sstream>
+#include <random>
+
+#include "Benchmark.hpp"
+#include "Graph.hpp"
+#include "Util.hpp"
+#include "Metrics.hpp"
+#include "Centrality.hpp"
+#include "NodeOrder.hpp"
+#include "Allocations.hpp"
+#include "DensityRenderer.hpp"
+#include "LayeredLayout.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace fs = std::filesystem;
+
+struct BenchResult {
+	double ms;
+	int iterations;
+	// heap allocations per step once buffers have grown
+	double allocations;
+	LayoutMetrics metrics;
+};
+
+// Steps before allocations are counted
+const int ALLOCATION_WARMUP = 5;
+
+// FR stops once it has cooled down, so a lower start temperature alone saves iterations.
+// Every start is run at both temperatures to keep that apart from the effect of the start positions.
+enum BenchAlgorithm { BenchFR, BenchFRCooled, BenchFRCommunities, BenchFRCommunitiesCooled, BenchFRTree, BenchFRTreeCooled, BenchSGD };
+
+static const char* algorithmName(BenchAlgorithm algorithm) {
+	switch (algorithm) {
+	case BenchFR: return "FR";
+	case BenchFRCooled: return "FR/8";
+	case BenchFRCommunities: return "FR+LV";
+	case BenchFRCommunitiesCooled: return "FR+LV/8";
+	case BenchFRTree: return "FR+ST";
+	case BenchFRTreeCooled: return "FR+ST/8";
+	default: return "SGD";
+	}
+}
+
+static BenchResult runOne(Graph G, const vector<Vector2f>& initial, BenchAlgorithm algorithm, const BenchOptions& options) {
+	// FR+LV starts from communities seeded in their own regions instead, FR+ST from a radial spanning tree
+	if (algorithm == BenchFRCommunities || algorithm == BenchFRCommunitiesCooled)
+		G.CommunityLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+	else if (algorithm == BenchFRTree || algorithm == BenchFRTreeCooled)
+		G.SpanningTreeLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+	else
+		G.setPositions(initial);
+	// '/8' rows start at SEEDED_TEMP like the GUI does after seeding, the others at DEFAULT_TEMP
+	bool cooled = algorithm == BenchFRCooled || algorithm == BenchFRCommunitiesCooled || algorithm == BenchFRTreeCooled;
+	G.setStartTemp(cooled ? SEEDED_TEMP : DEFAULT_TEMP);
+	FruchtermanParams params = calcFruchtParams(G.Nodes().size(), options.C);
+
+	auto start = chrono::steady_clock::now();
+	if (algorithm == BenchSGD)
+		G.StressSGD(params);
+	else
+		G.FruchtermanReingold(params);
+	// Every Update() call is an iteration, including the one that converges
+	int iterations = 0;
+	unsigned long long allocations = 0;
+	bool running = true;
+	while (running && iterations < options.maxIterations) {
+		running = G.Update();
+		if (iterations >= ALLOCATION_WARMUP)
+			allocations += G.StepAllocations();
+		iterations++;
+	}
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	double perStep = double(allocations) / max(1, iterations - ALLOCATION_WARMUP);
+	return { ms, iterations, perStep, layoutMetrics(G.Adjacency(), G.Positions()) };
+}
+
+// Barabasi-Albert graph: every new node links to m existing nodes picked proportionally to their degree
+static vector<list<int>> preferentialAttachment(int n, int m, unsigned seed) {
+	mt19937 rng(seed);
+	vector<list<int>> adjList(n);
+	// every node appears once per edge end, sampling from it is sampling by degree
+	vector<int> ends;
+	for (int v = 1; v <= m && v < n; ++v) {
+		adjList[0].push_back(v);
+		adjList[v].push_back(0);
+		ends.insert(ends.end(), { 0, v });
+	}
+	for (int v = m + 1; v < n; ++v) {
+		vector<int> targets;
+		while (targets.size() < m) {
+			int t = ends[uniform_int_distribution<size_t>(0, ends.size() - 1)(rng)];
+			if (find(targets.begin(), targets.end(), t) == targets.end())
+				targets.push_back(t);
+		}
+		for (int t : targets) {
+			adjList[v].push_back(t);
+			adjList[t].push_back(v);
+			ends.insert(ends.end(), { v, t });
+		}
+	}
+	return adjList;
+}
+
+// Hardware cache misses of the calling thread, -1 where they can't be counted (other systems, no permission)
+class CacheMisses {
+public:
+	CacheMisses() {
+#ifdef __linux__
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+	~CacheMisses() {
+#ifdef __linux__
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+	void start() {
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	long long stop() {
+		long long count = -1;
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &count, sizeof(count)) != sizeof(count))
+				count = -1;
+		}
+#endif
+		return count;
+	}
+	bool available() const { return fd >= 0; }
+private:
+	int fd = -1;
+};
+
+// Steps timed per node order, after ORDER_SGD_WARMUP epochs so Hilbert order has a layout to follow
+const int ORDER_SGD_WARMUP = 10;
+const int ORDER_SGD_EPOCHS = 5;
+const int ORDER_FR_STEPS = 3;
+
+// Graph with node ids shuffled, as an arbitrary file would number them
+static Graph shuffledGraph(const vector<list<int>>& adjList, unsigned seed) {
+	int n = adjList.size();
+	vector<int> id(n);
+	iota(id.begin(), id.end(), 0);
+	shuffle(id.begin(), id.end(), mt19937(seed));
+	vector<Node> nodes;
+	for (int i = 0; i < n; ++i)
+		nodes.push_back(Node::from_id(i));
+	vector<Edge> edges;
+	for (int i = 0; i < n; ++i) {
+		for (int j : adjList[i]) {
+			if (i < j)
+				edges.push_back(Edge(id[i], id[j]));
+		}
+	}
+	return Graph(nodes, edges);
+}
+
+static vector<list<int>> gridGraph(int side) {
+	vector<list<int>> adjList(side * side);
+	for (int r = 0; r < side; ++r) {
+		for (int c = 0; c < side; ++c) {
+			int v = r * side + c;
+			if (c + 1 < side) {
+				adjList[v].push_back(v + 1);
+				adjList[v + 1].push_back(v);
+			}
+			if (r + 1 < side) {
+				adjList[v].push_back(v + side);
+				adjList[v + side].push_back(v);
+			}
+		}
+	}
+	return adjList;
+}
+
+// Time per step and cache misses per step of 'steps' calls to G.Update()
+static pair<double, long long> timeSteps(Graph& G, int steps) {
+	CacheMisses misses;
+	misses.start();
+	auto start = chrono::steady_clock::now();
+	for (int k = 0; k < steps; ++k)
+		G.Update();
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	long long count = misses.stop();
+	return { ms / steps, count < 0 ? -1 : count / steps };
+}
+
+// Step time and cache misses with the nodes in file, RCM and Hilbert order, on generated graphs with shuffled ids
+static void benchOrdering(const BenchOptions& options) {
+	vector<pair<string, vector<list<int>>>> graphs = {
+		{ "BA-20000", preferentialAttachment(20000, 3, 20000) },
+		{ "grid-141", gridGraph(141) },
+	};
+	cout << endl;
+	if (!CacheMisses().available()) {
+#ifdef __linux__
+		cout << "Cache misses not counted: perf events are not permitted (see /proc/sys/kernel/perf_event_paranoid)" << endl;
+#else
+		cout << "Cache misses not counted: they are read from Linux perf events, not available on this system" << endl;
+#endif
+	}
+	cout << left << setw(20) << "graph" << setw(8) << "nodes" << setw(9) << "order" << setw(11) << "edge span"
+		<< setw(13) << "FR [ms/it]" << setw(15) << "FR misses/it" << setw(14) << "SGD [ms/it]" << "SGD misses/it" << endl;
+	for (auto& [name, adjList] : graphs) {
+		Graph warm = shuffledGraph(adjList, options.seed);
+		warm.setSeed(options.seed);
+		warm.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+		FruchtermanParams params = calcFruchtParams(warm.Nodes().size(), options.C);
+		warm.StressSGD(params);
+		for (int k = 0; k < ORDER_SGD_WARMUP; ++k)
+			warm.Update();
+
+		for (NodeOrdering ordering : { OrderFile, OrderRCM, OrderHilbert }) {
+			Graph G = warm;
+			G.setNodeOrdering(ordering);
+			auto [sgdMs, sgdMisses] = timeSteps(G, ORDER_SGD_EPOCHS);
+			G.FruchtermanReingold(params);
+			auto [frMs, frMisses] = timeSteps(G, ORDER_FR_STEPS);
+
+			const char* names[] = { "file", "rcm", "hilbert" };
+			auto count = [](long long v) { return v < 0 ? string("-") : to_string(v); };
+			cout << left << setw(20) << name << setw(8) << G.Nodes().size() << setw(9) << names[ordering]
+				<< setw(11) << fixed << setprecision(1) << edgeSpan(G.Adjacency()) << setw(13) << setprecision(2) << frMs
+				<< setw(15) << count(frMisses) << setw(14) << sgdMs << count(sgdMisses) << endl;
+		}
+	}
+}
+
+// Steps and density frames checked for allocations after warm-up
+const int ALLOCATION_CHECK_STEPS = 20;
+const int ALLOCATION_CHECK_FRAMES = 3;
+
+// Every algorithm must step without allocating once warmed up, and so must the density view.
+// Runs the bundled graphs and a generated one large enough for the parallel repulsion, returns the number of failures.
+static int checkAllocations(const vector<fs::path>& files, const BenchOptions& options) {
+	vector<pair<string, Graph>> graphs;
+	for (const fs::path& file : files)
+		graphs.push_back({ file.stem().string(), Graph::fromGML(file.string()) });
+	graphs.push_back({ "BA-2000", shuffledGraph(preferentialAttachment(2000, 3, 2000), options.seed) });
+
+	cout << endl << left << setw(20) << "graph" << setw(8) << "nodes" << setw(9) << "algo" << setw(9) << "steps" << "allocations" << endl;
+	int failures = 0;
+	auto report = [&](const string& name, const Graph& G, const char* what, int steps, unsigned long long allocations) {
+		cout << left << setw(20) << name << setw(8) << G.Nodes().size() << setw(9) << what << setw(9) << steps << allocations
+			<< (allocations > 0 ? "  FAILED" : "") << endl;
+		failures += allocations > 0;
+	};
+
+	const char* names[] = { "FR", "LinLog", "FA2", "SGD" };
+	for (auto& [name, graph] : graphs) {
+		if (graph.Nodes().empty())
+			continue;
+		graph.setSeed(options.seed);
+		graph.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+		for (int algorithm = 0; algorithm < 4; ++algorithm) {
+			Graph G = graph;
+			FruchtermanParams params = calcFruchtParams(G.Nodes().size(), options.C);
+			switch (algorithm) {
+			case 0: G.FruchtermanReingold(params); break;
+			case 1: G.LinLog(params); break;
+			case 2: G.ForceAtlas2(params); break;
+			default: G.StressSGD(params);
+			}
+			// The converging step separates nodes and bundles edges once, only steady steps count
+			bool running = true;
+			for (int k = 0; k < ALLOCATION_WARMUP && running; ++k)
+				running = G.Update();
+			int steps = 0;
+			unsigned long long allocations = 0;
+			while (running && steps < ALLOCATION_CHECK_STEPS) {
+				running = G.Update();
+				if (running) {
+					allocations += G.StepAllocations();
+					steps++;
+				}
+			}
+			report(name, G, names[algorithm], steps, allocations);
+		}
+
+		// Density view frames, drawing needs a window so only the pixel buffer is built
+		DensityRenderer density;
+		Vector2u size(CANVAS_WIDTH, CANVAS_HEIGHT);
+		density.render(size, graph.Positions(), graph.Edges(), EqualizeTransfer);
+		unsigned long long before = allocationCount();
+		for (int k = 0; k < ALLOCATION_CHECK_FRAMES; ++k)
+			density.render(size, graph.Positions(), graph.Edges(), k % 2 ? LogTransfer : EqualizeTransfer);
+		report(name, graph, "density", ALLOCATION_CHECK_FRAMES, allocationCount() - before);
+	}
+	return failures;
+}
+
+// The layered layout must follow edge directions as given, also where the source has the higher id.
+// A DAG numbered back to front must draw every arc downwards and a cycle must get one arc reversed.
+static int checkLayered(const BenchOptions& options) {
+	vector<Node> nodes;
+	for (int i = 0; i < 4; ++i)
+		nodes.push_back(Node::from_id(i));
+	vector<Edge> edges = { Edge(3, 2), Edge(2, 1), Edge(1, 0), Edge(3, 0) };
+	Graph G(nodes, edges);
+	G.Layered(calcFruchtParams(G.Nodes().size(), options.C));
+	G.Update();
+	int downwards = 0;
+	for (const Edge& e : G.Edges())
+		downwards += G.Positions()[e.source()].y < G.Positions()[e.target()].y;
+
+	vector<Vector2f> positions(3);
+	LayeredStats cycle = layeredLayout(3, { { 0, 1 }, { 1, 2 }, { 2, 0 } }, { 0, 0 }, { 100, 100 }, positions);
+
+	bool dagOk = downwards == (int)G.Edges().size(), cycleOk = cycle.reversed == 1;
+	cout << endl << "layered DAG numbered back to front: " << downwards << "/" << G.Edges().size() << " arcs downwards"
+		<< (dagOk ? "" : "  FAILED") << endl;
+	cout << "layered 3-cycle: " << cycle.reversed << " arc reversed" << (cycleOk ? "" : "  FAILED") << endl;
+	return !dagOk + !cycleOk;
+}
+
+static double timeCentrality(const vector<list<int>>& adjList, int samples, Centrality& result) {
+	auto start = chrono::steady_clock::now();
+	computeCentrality(adjList, result, samples);
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Centrality timings, exact and sampled, on the bundled graphs and generated scale-free graphs
+static void benchCentrality(const vector<fs::path>& files) {
+	vector<pair<string, vector<list<int>>>> graphs;
+	for (const fs::path& file : files)
+		graphs.push_back({ file.stem().string(), Graph::fromGML(file.string()).Adjacency() });
+	for (int n : { 1000, 5000, 20000, 100000 })
+		graphs.push_back({ "BA-" + to_string(n), preferentialAttachment(n, 3, n) });
+
+	cout << endl << left << setw(20) << "graph" << setw(8) << "nodes" << setw(16) << "exact [ms]"
+		<< setw(16) << "sampled [ms]" << "top-10 overlap" << endl;
+	for (auto& [name, adjList] : graphs) {
+		int n = adjList.size();
+		Centrality exact, sampled;
+		// exact Brandes is O(nm), skip it where it would take minutes
+		double exactMs = n <= EXACT_CENTRALITY_NODES ? timeCentrality(adjList, 0, exact) : -1.;
+		double sampledMs = n > CENTRALITY_SAMPLES ? timeCentrality(adjList, CENTRALITY_SAMPLES, sampled) : -1.;
+
+		// How many of the 10 most central nodes the estimate finds
+		string overlap = "-";
+		if (exactMs >= 0. && sampledMs >= 0.) {
+			auto top = [](const vector<float>& values) {
+				vector<int> order(values.size());
+				iota(order.begin(), order.end(), 0);
+				partial_sort(order.begin(), order.begin() + 10, order.end(), [&](int a, int b) { return values[a] > values[b]; });
+				order.resize(10);
+				sort(order.begin(), order.end());
+				return order;
+			};
+			vector<int> a = top(exact.betweenness), b = top(sampled.betweenness), common;
+			set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(common));
+			overlap = to_string(common.size()) + "/10";
+		}
+
+		auto ms = [](double v) { stringstream s; if (v < 0.) s << "-"; else s << fixed << setprecision(2) << v; return s.str(); };
+		cout << left << setw(20) << name << setw(8) << n << setw(16) << ms(exactMs) << setw(16) << ms(sampledMs) << overlap << endl;
+	}
+}
+
+int runBenchmark(const BenchOptions& options)
+{
+	vector<fs::path> files;
+	for (const auto& entry : fs::directory_iterator(options.graphsDir)) {
+		if (entry.path().extension() == ".gml")
+			files.push_back(entry.path());
+	}
+	sort(files.begin(), files.end());
+
+	cout << left << setw(20) << "graph" << setw(8) << "nodes" << setw(8) << "edges"
+		<< setw(9) << "algo" << setw(12) << "time [ms]" << setw(12) << "iterations" << setw(11) << "allocs/it" << setw(11) << "crossings"
+		<< setw(9) << "stress" << setw(9) << "neighb." << setw(9) << "angular" << "edge var." << endl;
+
+	for (const fs::path& file : files) {
+		Graph G = Graph::fromGML(file.string());
+		if (G.Nodes().empty())
+			continue;
+		G.setSeed(options.seed);
+		G.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+		vector<Vector2f> initial = G.Positions();
+
+		for (BenchAlgorithm algorithm : { BenchFR, BenchFRCooled, BenchFRCommunities, BenchFRCommunitiesCooled, BenchFRTree, BenchFRTreeCooled, BenchSGD }) {
+			BenchResult r = runOne(G, initial, algorithm, options);
+			cout << left << setw(20) << file.stem().string() << setw(8) << G.Nodes().size() << setw(8) << G.Edges().size()
+				<< setw(9) << algorithmName(algorithm) << setw(12) << fixed << setprecision(2) << r.ms
+				<< setw(12) << r.iterations << setw(11) << setprecision(1) << r.allocations << setw(11) << r.metrics.crossings << setprecision(4) << setw(9) << r.metrics.stress
+				<< setw(9) << r.metrics.neighbourhood << setw(9) << r.metrics.angularResolution << r.metrics.edgeLengthVariance << endl;
+		}
+	}
+
+	benchCentrality(files);
+	benchOrdering(options);
+	if (int failures = checkAllocations(files, options) + checkLayered(options)) {
+		cout << failures << " checks failed" << endl;
+		return 1;
+	}
+	return 0;
+}
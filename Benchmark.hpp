@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+using namespace std;
+
+struct BenchOptions {
+	// every .gml file in this directory is benchmarked
+	string graphsDir = "graphs";
+	int maxIterations = 10000;
+	float C = 0.7f;
+	// seed of the random initial layouts
+	unsigned seed = 0;
+};
+
+/* Benchmark suite
+*
+* Lays out every bundled graph with each algorithm from the same initial positions
+* and prints runtime, iterations, heap allocations per step after warm-up and layout quality (crossings, stress, neighbourhood preservation,
+* angular resolution, edge length variance) side by side.
+* FR+LV is Fruchterman-Reingold started from the Louvain community seeded layout (timing includes detection).
+* A second table times exact and sampled centrality on the same graphs and on generated scale-free graphs.
+* A third one compares step time and cache misses (Linux perf counters, thread running the steps) of file, RCM
+* and Hilbert node order on generated graphs with shuffled node ids.
+* Last, every algorithm is stepped and density frames are built after warm-up, any heap allocation fails the run (exit code 1),
+* and so does a layered layout of a small directed graph that doesn't follow the edge directions.
+*/
+int runBenchmark(const BenchOptions& options);
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <mutex>
+
+#include "Centrality.hpp"
+#include "ThreadPool.hpp"
+
+// Work per task, in visited nodes and edges, keeps tasks short enough to interleave with layout work
+const size_t BLOCK_WORK = 1 << 20;
+
+// Per task buffers, reused by the next task once released
+struct Accumulator {
+	vector<double> betweenness;
+	// sampled closeness: sum of distances to sources and number of sources reaching the node
+	vector<double> distanceSum;
+	vector<int> reachedBy;
+
+	// BFS state
+	vector<int> dist;
+	vector<double> sigma, delta;
+	vector<int> order;
+
+	Accumulator(int n) : betweenness(n, 0.), distanceSum(n, 0.), reachedBy(n, 0), dist(n, -1), sigma(n, 0.), delta(n, 0.) {
+		order.reserve(n);
+	}
+};
+
+bool computeCentrality(const vector<list<int>>& adjList, Centrality& result, int samples, function<bool()> cancelled, unsigned seed)
+{
+	int n = adjList.size();
+	result.betweenness.assign(n, 0.f);
+	result.closeness.assign(n, 0.f);
+	result.exact = samples <= 0 || samples >= n;
+	if (n == 0)
+		return true;
+
+	// Adjacency in one array, BFS over linked lists is dominated by cache misses
+	vector<int> start(n + 1, 0), neighbours;
+	for (int v = 0; v < n; ++v)
+		start[v + 1] = start[v] + adjList[v].size();
+	neighbours.reserve(start[n]);
+	for (const list<int>& l : adjList)
+		neighbours.insert(neighbours.end(), l.begin(), l.end());
+
+	vector<int> sources(n);
+	iota(sources.begin(), sources.end(), 0);
+	if (!result.exact) {
+		mt19937 rng(seed);
+		shuffle(sources.begin(), sources.end(), rng);
+		sources.resize(samples);
+	}
+	int k = sources.size();
+	int block = max<size_t>(1, BLOCK_WORK / (n + neighbours.size()));
+
+	mutex freeMutex;
+	vector<unique_ptr<Accumulator>> accumulators;
+	vector<Accumulator*> freeList;
+	auto acquire = [&]() {
+		lock_guard<mutex> lock(freeMutex);
+		if (freeList.empty()) {
+			accumulators.emplace_back(new Accumulator(n));
+			return accumulators.back().get();
+		}
+		Accumulator* a = freeList.back();
+		freeList.pop_back();
+		return a;
+	};
+	auto release = [&](Accumulator* a) {
+		lock_guard<mutex> lock(freeMutex);
+		freeList.push_back(a);
+	};
+
+	atomic<bool> stop{ false };
+	auto runBlock = [&](int from, int to) {
+		if (stop || (cancelled && cancelled())) {
+			stop = true;
+			return;
+		}
+		Accumulator& a = *acquire();
+		for (int i = from; i < to; ++i) {
+			int s = sources[i];
+
+			// BFS counting shortest paths
+			a.order.clear();
+			a.order.push_back(s);
+			a.dist[s] = 0;
+			a.sigma[s] = 1.;
+			double distanceTotal = 0.;
+			for (size_t head = 0; head < a.order.size(); ++head) {
+				int u = a.order[head];
+				distanceTotal += a.dist[u];
+				for (int e = start[u]; e < start[u + 1]; ++e) {
+					int v = neighbours[e];
+					if (a.dist[v] == -1) {
+						a.dist[v] = a.dist[u] + 1;
+						a.order.push_back(v);
+					}
+					if (a.dist[v] == a.dist[u] + 1)
+						a.sigma[v] += a.sigma[u];
+				}
+			}
+
+			// Dependencies in reverse BFS order, predecessors are neighbours one level closer
+			for (int j = a.order.size() - 1; j >= 0; --j) {
+				int w = a.order[j];
+				for (int e = start[w]; e < start[w + 1]; ++e) {
+					int v = neighbours[e];
+					if (a.dist[v] == a.dist[w] - 1)
+						a.delta[v] += a.sigma[v] / a.sigma[w] * (1. + a.delta[w]);
+				}
+				if (w != s)
+					a.betweenness[w] += a.delta[w];
+			}
+
+			int reached = a.order.size();
+			if (result.exact) {
+				// Only this task writes slot s
+				if (distanceTotal > 0.)
+					result.closeness[s] = (float)((reached - 1.) / (n - 1.) * (reached - 1.) / distanceTotal);
+			}
+			else {
+				for (int v : a.order) {
+					a.distanceSum[v] += a.dist[v];
+					a.reachedBy[v]++;
+				}
+			}
+
+			for (int v : a.order) {
+				a.dist[v] = -1;
+				a.sigma[v] = 0.;
+				a.delta[v] = 0.;
+			}
+		}
+		release(&a);
+	};
+
+	{
+		TaskGroup group(ThreadPool::global());
+		for (int from = 0; from < k; from += block) {
+			int to = min(k, from + block);
+			group.run([&runBlock, from, to]() { runBlock(from, to); });
+		}
+		group.wait();
+	}
+	if (stop)
+		return false;
+
+	// Sum the buffers, every pair was counted from both ends
+	double scale = (double)n / k / 2.;
+	for (int v = 0; v < n; ++v) {
+		double b = 0.;
+		for (auto& a : accumulators)
+			b += a->betweenness[v];
+		result.betweenness[v] = (float)(b * scale);
+	}
+
+	if (!result.exact) {
+		for (int v = 0; v < n; ++v) {
+			double sum = 0.;
+			int reachedBy = 0;
+			for (auto& a : accumulators) {
+				sum += a->distanceSum[v];
+				reachedBy += a->reachedBy[v];
+			}
+			// Fraction of sources reaching v stands for the fraction of the graph it reaches
+			if (sum > 0.)
+				result.closeness[v] = (float)((double)reachedBy / k * reachedBy / sum);
+		}
+	}
+	return true;
+}
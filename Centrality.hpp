@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <functional>
+
+using namespace std;
+
+struct Centrality {
+	// Betweenness of every node (undirected, pairs counted once)
+	vector<float> betweenness;
+	// Closeness of every node, Wasserman-Faust variant so disconnected graphs are handled
+	vector<float> closeness;
+	// false if estimated from sampled sources
+	bool exact = true;
+};
+
+/* Betweenness and closeness centrality (Brandes, 2001)
+*
+* One BFS per source counts shortest paths, dependencies are then accumulated in reverse BFS order.
+* Sources are split into blocks run as tasks on the global thread pool, every running task
+* accumulates into its own buffer and the buffers are summed at the end.
+* With samples > 0 only that many random sources are used and results are scaled up (Brandes & Pich, 2007),
+* closeness of every node is then estimated from its distances to the sampled sources.
+*
+* cancelled - polled between blocks, computation stops early and returns false if it returns true
+*/
+bool computeCentrality(const vector<list<int>>& adjList, Centrality& result, int samples = 0,
+	function<bool()> cancelled = nullptr, unsigned seed = 0);
@@ -0,0 +1,112 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "Cli.hpp"
+#include "Batch.hpp"
+#include "Benchmark.hpp"
+#include "LayoutService.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+static void printUsage() {
+	cout << "Usage:" << endl
+		<< "  TinyGraphViz                      start the GUI" << endl
+		<< "  TinyGraphViz --batch <dir|manifest> [--out <dir>] [--in-flight N] [--threads N]" << endl
+		<< "               [--algorithm fr|linlog|fa2|sgd|tree|radial|layered|auto] [--C value] [--max-iterations N] [--seed N]" << endl
+		<< "               [--order file|rcm|hilbert] [--metrics]" << endl
+		<< "  TinyGraphViz --bench [graphs dir] [--C value] [--max-iterations N] [--seed N]" << endl
+		<< "  TinyGraphViz --serve [socket path] [--port N] [--threads N] [--max-active N] [--max-queued N]" << endl
+		<< "               [--max-sessions N] [--budget ms] [--C value] [--max-iterations N]" << endl;
+}
+
+int runCli(int argc, char** argv)
+{
+	if (argc < 2)
+		return -1;
+
+	vector<string> args(argv + 1, argv + argc);
+	auto value = [&](size_t& i) -> string {
+		if (i + 1 >= args.size())
+			throw invalid_argument("Missing value for " + args[i]);
+		return args[++i];
+	};
+
+	try {
+		string mode;
+		BatchOptions batch;
+		BenchOptions bench;
+		ServiceOptions service;
+		for (size_t i = 0; i < args.size(); ++i) {
+			const string& arg = args[i];
+			if (arg == "--batch") {
+				mode = "batch";
+				batch.input = value(i);
+			}
+			else if (arg == "--bench") {
+				mode = "bench";
+				if (i + 1 < args.size() && args[i + 1].rfind("--", 0) != 0)
+					bench.graphsDir = value(i);
+			}
+			else if (arg == "--serve") {
+				mode = "serve";
+				if (i + 1 < args.size() && args[i + 1].rfind("--", 0) != 0)
+					service.socketPath = value(i);
+			}
+			else if (arg == "--port")
+				service.port = stoi(value(i));
+			else if (arg == "--max-active")
+				service.maxActive = stoi(value(i));
+			else if (arg == "--max-queued")
+				service.maxQueued = stoi(value(i));
+			else if (arg == "--max-sessions")
+				service.maxSessions = stoi(value(i));
+			else if (arg == "--budget")
+				service.budgetMs = stoi(value(i));
+			else if (arg == "--out")
+				batch.outputDir = value(i);
+			else if (arg == "--in-flight")
+				batch.inFlight = stoi(value(i));
+			else if (arg == "--threads")
+				ThreadPool::configureGlobal(stoi(value(i)));
+			else if (arg == "--algorithm")
+				batch.algorithm = value(i);
+			else if (arg == "--C")
+				batch.C = bench.C = service.C = stof(value(i));
+			else if (arg == "--seed")
+				batch.seed = bench.seed = stoul(value(i));
+			else if (arg == "--order") {
+				batch.order = value(i);
+				if (batch.order != "file" && batch.order != "rcm" && batch.order != "hilbert")
+					throw invalid_argument("Unknown node order " + batch.order);
+			}
+			else if (arg == "--metrics")
+				batch.metrics = true;
+			else if (arg == "--max-iterations")
+				batch.maxIterations = bench.maxIterations = service.maxIterations = stoi(value(i));
+			else if (arg == "--help" || arg == "-h") {
+				printUsage();
+				return 0;
+			}
+			else
+				throw invalid_argument("Unknown argument " + arg);
+		}
+
+		if (mode == "batch")
+			return runBatch(batch) == 0 ? 0 : 1;
+		if (mode == "bench")
+			return runBenchmark(bench);
+		if (mode == "serve")
+			return runService(service);
+
+		printUsage();
+		return 1;
+	}
+	catch (const exception& e) {
+		cout << e.what() << endl;
+		printUsage();
+		return 1;
+	}
+}
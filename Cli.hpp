@@ -0,0 +1,16 @@
+#pragma once
+
+/* Command line modes
+*
+* TinyGraphViz --batch <dir|manifest> [--out <dir>] [--in-flight N] [--threads N]
+*              [--algorithm fr|linlog|fa2|sgd|tree|radial|layered|auto] [--C value] [--max-iterations N] [--seed N]
+*              [--order file|rcm|hilbert] [--metrics]
+* TinyGraphViz --bench [graphs dir] [--C value] [--max-iterations N] [--seed N]
+* TinyGraphViz --serve [socket path] [--port N] [--threads N] [--max-active N] [--max-queued N]
+*              [--budget ms] [--C value] [--max-iterations N]
+*
+* Without arguments the GUI is started.
+*/
+
+// Run the mode selected by the arguments, returns the process exit code or -1 if the GUI should start
+int runCli(int argc, char** argv);
@@ -0,0 +1,255 @@
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+#include "Community.hpp"
+#include "Parallel.hpp"
+
+// Stop local moving when a sweep improves modularity by less than this
+const double MIN_GAIN = 1e-7;
+const int MAX_SWEEPS = 100;
+
+// Weighted graph in CSR form, self loops hold the weight inside merged communities
+// A self loop is stored once with twice its weight, like an edge seen from both ends
+struct WeightedGraph {
+	vector<int> start;
+	vector<int> neighbours;
+	vector<double> weights;
+	// weighted degree
+	vector<double> strength;
+	double total = 0.;
+
+	int size() const { return start.size() - 1; }
+};
+
+static WeightedGraph fromEdges(int n, const vector<Edge>& edges, bool weighted)
+{
+	WeightedGraph g;
+	g.start.assign(n + 1, 0);
+	for (const Edge& e : edges) {
+		g.start[e[0] + 1]++;
+		if (e[0] != e[1])
+			g.start[e[1] + 1]++;
+	}
+	partial_sum(g.start.begin(), g.start.end(), g.start.begin());
+
+	g.neighbours.resize(g.start[n]);
+	g.weights.resize(g.start[n]);
+	g.strength.assign(n, 0.);
+	vector<int> fill(g.start.begin(), g.start.end() - 1);
+	for (const Edge& e : edges) {
+		double w = weighted ? e.weight : 1.;
+		g.strength[e[0]] += w;
+		g.strength[e[1]] += w;
+		if (e[0] == e[1]) {
+			g.neighbours[fill[e[0]]] = e[0];
+			g.weights[fill[e[0]]++] = 2. * w;
+			continue;
+		}
+		g.neighbours[fill[e[0]]] = e[1];
+		g.weights[fill[e[0]]++] = w;
+		g.neighbours[fill[e[1]]] = e[0];
+		g.weights[fill[e[1]]++] = w;
+	}
+	g.total = accumulate(g.strength.begin(), g.strength.end(), 0.);
+	return g;
+}
+
+// Merge every community into one node
+static WeightedGraph aggregate(const WeightedGraph& g, const vector<int>& community, int count)
+{
+	vector<vector<pair<int, double>>> links(count);
+	for (int u = 0; u < g.size(); ++u) {
+		for (int k = g.start[u]; k < g.start[u + 1]; ++k)
+			links[community[u]].push_back({ community[g.neighbours[k]], g.weights[k] });
+	}
+
+	WeightedGraph a;
+	a.start.assign(count + 1, 0);
+	a.strength.assign(count, 0.);
+	for (int c = 0; c < count; ++c) {
+		// sum parallel links
+		sort(links[c].begin(), links[c].end());
+		int merged = 0;
+		for (int k = 0; k < links[c].size(); ++k) {
+			if (merged > 0 && links[c][merged - 1].first == links[c][k].first)
+				links[c][merged - 1].second += links[c][k].second;
+			else
+				links[c][merged++] = links[c][k];
+		}
+		links[c].resize(merged);
+		a.start[c + 1] = a.start[c] + merged;
+		for (auto& [d, w] : links[c]) {
+			a.neighbours.push_back(d);
+			a.weights.push_back(w);
+			a.strength[c] += w;
+		}
+	}
+	a.total = g.total;
+	return a;
+}
+
+class LocalMoving
+{
+public:
+	LocalMoving(const WeightedGraph& g, double resolution) : g(g), resolution(resolution) {
+		int n = g.size();
+		community.resize(n);
+		iota(community.begin(), community.end(), 0);
+		tot = g.strength;
+		proposal.resize(n);
+	}
+
+	// Returns true if any node moved
+	bool run(const function<bool()>& cancelled) {
+		bool moved = false;
+		for (int sweep = 0; sweep < MAX_SWEEPS; ++sweep) {
+			if (cancelled && cancelled())
+				break;
+			// Propose moves against the current communities
+			parallelFor(0, g.size(), [&](int u) {
+				vector<double>& linkTo = scratch();
+				proposal[u] = bestCommunity(u, linkTo);
+			});
+
+			// Apply them in order, a move stays only if it still improves modularity
+			double gain = 0.;
+			vector<double>& linkTo = scratch();
+			for (int u = 0; u < g.size(); ++u) {
+				if (proposal[u] == community[u])
+					continue;
+				int from = community[u];
+				int to = bestCommunity(u, linkTo);
+				if (to == from)
+					continue;
+				gain += moveGain(u, to, linkTo) - moveGain(u, from, linkTo);
+				tot[from] -= g.strength[u];
+				tot[to] += g.strength[u];
+				community[u] = to;
+				moved = true;
+			}
+			if (gain < MIN_GAIN)
+				break;
+		}
+		return moved;
+	}
+
+	// Renumber communities to 0..count-1, returns count
+	int renumber() {
+		vector<int> id(g.size(), -1);
+		int count = 0;
+		for (int& c : community) {
+			if (id[c] == -1)
+				id[c] = count++;
+			c = id[c];
+		}
+		return count;
+	}
+
+	vector<int> community;
+private:
+	// Modularity gain of putting isolated u into community c, up to a constant
+	double moveGain(int u, int c, const vector<double>& linkTo) const {
+		double t = tot[c] - (community[u] == c ? g.strength[u] : 0.);
+		return linkTo[c] - resolution * t * g.strength[u] / g.total;
+	}
+
+	// Neighbouring community (or its own) with the highest gain for node u
+	// linkTo is filled with weights from u to neighbouring communities
+	int bestCommunity(int u, vector<double>& linkTo) const {
+		for (int k = g.start[u]; k < g.start[u + 1]; ++k)
+			linkTo[community[g.neighbours[k]]] = 0.;
+		linkTo[community[u]] = 0.;
+		for (int k = g.start[u]; k < g.start[u + 1]; ++k) {
+			if (g.neighbours[k] != u)
+				linkTo[community[g.neighbours[k]]] += g.weights[k];
+		}
+
+		int best = community[u];
+		double bestGain = moveGain(u, best, linkTo);
+		for (int k = g.start[u]; k < g.start[u + 1]; ++k) {
+			int c = community[g.neighbours[k]];
+			double gain = moveGain(u, c, linkTo);
+			// stay unless strictly better, ties between other communities go to the lower id
+			if (gain > bestGain + MIN_GAIN || (best != community[u] && abs(gain - bestGain) <= MIN_GAIN && c < best)) {
+				best = c;
+				bestGain = gain;
+			}
+		}
+		return best;
+	}
+
+	// Per thread buffer indexed by community
+	vector<double>& scratch() const {
+		thread_local vector<double> buffer;
+		if (buffer.size() < g.size())
+			buffer.resize(g.size());
+		return buffer;
+	}
+
+	const WeightedGraph& g;
+	double resolution;
+	vector<double> tot;
+	vector<int> proposal;
+};
+
+static double modularity(const WeightedGraph& g, const vector<int>& community, int count, double resolution)
+{
+	if (g.total == 0.)
+		return 0.;
+	vector<double> in(count, 0.), tot(count, 0.);
+	for (int u = 0; u < g.size(); ++u) {
+		tot[community[u]] += g.strength[u];
+		for (int k = g.start[u]; k < g.start[u + 1]; ++k) {
+			if (community[g.neighbours[k]] == community[u])
+				in[community[u]] += g.weights[k];
+		}
+	}
+	double q = 0.;
+	for (int c = 0; c < count; ++c)
+		q += in[c] / g.total - resolution * (tot[c] / g.total) * (tot[c] / g.total);
+	return q;
+}
+
+Communities louvain(int numNodes, const vector<Edge>& edges, bool weighted, double resolution, function<bool()> cancelled)
+{
+	Communities result;
+	result.of.resize(numNodes);
+	iota(result.of.begin(), result.of.end(), 0);
+	if (numNodes == 0)
+		return result;
+
+	WeightedGraph original = fromEdges(numNodes, edges, weighted);
+	WeightedGraph g = original;
+	int count = numNodes;
+	while (true) {
+		LocalMoving moving(g, resolution);
+		bool moved = moving.run(cancelled);
+		int merged = moving.renumber();
+		for (int& c : result.of)
+			c = moving.community[c];
+		if (!moved || merged == count || (cancelled && cancelled()))
+			break;
+		count = merged;
+		g = aggregate(g, moving.community, count);
+	}
+	count = *max_element(result.of.begin(), result.of.end()) + 1;
+
+	// Number communities by decreasing size
+	vector<int> sizes(count, 0);
+	for (int c : result.of)
+		sizes[c]++;
+	vector<int> order(count);
+	iota(order.begin(), order.end(), 0);
+	stable_sort(order.begin(), order.end(), [&](int a, int b) { return sizes[a] > sizes[b]; });
+	vector<int> rank(count);
+	for (int r = 0; r < count; ++r)
+		rank[order[r]] = r;
+	result.sizes.resize(count);
+	for (int& c : result.of) {
+		c = rank[c];
+		result.sizes[c]++;
+	}
+	result.modularity = modularity(original, result.of, count, resolution);
+	return result;
+}
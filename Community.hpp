@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <functional>
+
+#include "Edge.hpp"
+
+using namespace std;
+using namespace sf;
+
+struct Communities {
+	// community of every node, communities are numbered by decreasing size
+	vector<int> of;
+	// number of nodes in every community
+	vector<int> sizes;
+	double modularity = 0.;
+
+	int count() const { return sizes.size(); }
+};
+
+/* Louvain community detection (Blondel et al., 2008)
+*
+* Local moving: every node moves to the neighbouring community with the largest modularity gain
+* until no move improves modularity, then communities are merged into single nodes and the
+* same is repeated on the smaller graph.
+* Best moves of all nodes are evaluated in parallel against a snapshot of the communities,
+* only proposed moves are then applied one by one, re-checking their gain, so modularity never decreases.
+*
+* weighted - use edge weights, otherwise every edge weighs 1
+* resolution - larger values give more, smaller communities
+* cancelled - checked before every sweep, once it returns true the communities found so far are returned
+*/
+Communities louvain(int numNodes, const vector<Edge>& edges, bool weighted = false, double resolution = 1., function<bool()> cancelled = nullptr);
@@ -0,0 +1,255 @@
+#include <cmath>
+#include <algorithm>
+
+#include "DensityRenderer.hpp"
+#include "Parallel.hpp"
+#include <SFML/Graphics/Sprite.hpp>
+
+// Number of distinct density levels, counts above it are scaled down
+const int LEVELS = 1024;
+// A node counts as this many edge pixels
+const Uint32 NODE_WEIGHT = 4;
+// Rows per band, bands are the unit of parallel work
+const int BAND_ROWS = 32;
+// Segments are clipped this far inside the grid, so the last sample stays on a pixel
+const float CLIP_MARGIN = 0.001f;
+
+// Colour ramp from sparse to dense
+const Color RAMP[] = { Color(20, 30, 90), Color(30, 120, 200), Color(240, 200, 60), Color(255, 255, 255) };
+const int RAMP_SIZE = sizeof(RAMP) / sizeof(RAMP[0]);
+
+static Color ramp(float v) {
+	float x = min(max(v, 0.f), 1.f) * (RAMP_SIZE - 1);
+	int i = min((int)x, RAMP_SIZE - 2);
+	float t = x - i;
+	const Color& a = RAMP[i];
+	const Color& b = RAMP[i + 1];
+	return Color(
+		(Uint8)(a.r + (b.r - a.r) * t),
+		(Uint8)(a.g + (b.g - a.g) * t),
+		(Uint8)(a.b + (b.b - a.b) * t));
+}
+
+void DensityRenderer::update(Vector2u size, const vector<Vector2f>& positions, const vector<Edge>& edges, DensityTransfer transfer)
+{
+	bool resized = size.x != width || size.y != height;
+	render(size, positions, edges, transfer);
+	if (resized)
+		texture.create(width, height);
+	if (width == 0 || height == 0)
+		return;
+	texture.update(pixels.data());
+}
+
+void DensityRenderer::render(Vector2u size, const vector<Vector2f>& positions, const vector<Edge>& edges, DensityTransfer transfer)
+{
+	if (size.x != width || size.y != height) {
+		width = size.x;
+		height = size.y;
+		counts.assign((size_t)width * height, 0);
+		pixels.assign((size_t)width * height * 4, 0);
+	}
+	if (width == 0 || height == 0)
+		return;
+
+	int bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+	bandMax.assign(bands, 0);
+	bandLevels.assign((size_t)bands * LEVELS, 0);
+
+	binByBand(bands, positions, edges);
+	parallelFor(0, bands, [&](int b) {
+		int rowBegin = b * BAND_ROWS;
+		int rowEnd = min((int)height, rowBegin + BAND_ROWS);
+		fill(counts.begin() + (size_t)rowBegin * width, counts.begin() + (size_t)rowEnd * width, 0);
+		accumulate(b, rowBegin, rowEnd, positions, edges);
+
+		Uint32 m = 0;
+		for (size_t p = (size_t)rowBegin * width; p < (size_t)rowEnd * width; ++p)
+			m = max(m, counts[p]);
+		bandMax[b] = m;
+	}, 1);
+	maxCount = *max_element(bandMax.begin(), bandMax.end());
+
+	// Histogram of levels, needed for equalization
+	if (transfer == EqualizeTransfer) {
+		parallelFor(0, bands, [&](int b) {
+			Uint32* hist = &bandLevels[(size_t)b * LEVELS];
+			int rowEnd = min((int)height, (b + 1) * BAND_ROWS);
+			for (size_t p = (size_t)b * BAND_ROWS * width; p < (size_t)rowEnd * width; ++p) {
+				if (counts[p] != 0)
+					hist[level(counts[p])]++;
+			}
+		}, 1);
+	}
+	buildPalette(transfer);
+
+	parallelFor(0, bands, [&](int b) {
+		int rowEnd = min((int)height, (b + 1) * BAND_ROWS);
+		for (size_t p = (size_t)b * BAND_ROWS * width; p < (size_t)rowEnd * width; ++p) {
+			Color c = counts[p] == 0 ? Color::Transparent : palette[level(counts[p])];
+			pixels[4 * p] = c.r;
+			pixels[4 * p + 1] = c.g;
+			pixels[4 * p + 2] = c.b;
+			pixels[4 * p + 3] = c.a;
+		}
+	}, 1);
+}
+
+void DensityRenderer::draw(RenderTarget& target, RenderStates states) const
+{
+	if (width == 0 || height == 0)
+		return;
+	target.draw(Sprite(texture), states);
+}
+
+// Counting sort of items 0..count-1 into the bands [first, last] given by range(i),
+// the items of band b end up in items[start[b], start[b + 1]) in index order
+template<typename Range>
+static void binItems(int bands, int count, Range range, vector<int>& start, vector<int>& items)
+{
+	start.assign(bands + 1, 0);
+	for (int i = 0; i < count; ++i) {
+		auto [first, last] = range(i);
+		for (int b = first; b <= last; ++b)
+			start[b + 1]++;
+	}
+	for (int b = 0; b < bands; ++b)
+		start[b + 1] += start[b];
+	items.resize(start[bands]);
+
+	// Filling moves every offset to the start of the next band, shift them back afterwards
+	for (int i = 0; i < count; ++i) {
+		auto [first, last] = range(i);
+		for (int b = first; b <= last; ++b)
+			items[start[b]++] = i;
+	}
+	for (int b = bands; b > 0; --b)
+		start[b] = start[b - 1];
+	start[0] = 0;
+}
+
+void DensityRenderer::binByBand(int bands, const vector<Vector2f>& positions, const vector<Edge>& edges)
+{
+	auto bandOf = [](float y) { return (int)y / BAND_ROWS; };
+
+	// A node falls into one band, nodes outside the grid into none
+	binItems(bands, positions.size(), [&](int i) {
+		const Vector2f& p = positions[i];
+		if (!(p.y >= 0.f && p.y < height && p.x >= 0.f && p.x < width))
+			return pair<int, int>(1, 0);
+		return pair<int, int>(bandOf(p.y), bandOf(p.y));
+	}, nodeStart, nodeItems);
+
+	// An edge falls into every band its vertical extent crosses
+	edgeBands.resize(edges.size());
+	for (int e = 0; e < (int)edges.size(); ++e) {
+		float y0 = positions[edges[e][0]].y, y1 = positions[edges[e][1]].y;
+		float lo = min(y0, y1), hi = max(y0, y1);
+		if (!(hi >= 0.f && lo < height))
+			edgeBands[e] = { 1, 0 };
+		else
+			edgeBands[e] = { bandOf(max(lo, 0.f)), min(bands - 1, bandOf(hi)) };
+	}
+	binItems(bands, edges.size(), [&](int e) { return edgeBands[e]; }, edgeStart, edgeItems);
+}
+
+void DensityRenderer::accumulate(int b, int rowBegin, int rowEnd, const vector<Vector2f>& positions, const vector<Edge>& edges)
+{
+	for (int k = edgeStart[b]; k < edgeStart[b + 1]; ++k) {
+		const Edge& e = edges[edgeItems[k]];
+		rasterize(positions[e[0]], positions[e[1]], rowBegin, rowEnd);
+	}
+
+	for (int k = nodeStart[b]; k < nodeStart[b + 1]; ++k) {
+		const Vector2f& p = positions[nodeItems[k]];
+		counts[(size_t)p.y * width + (size_t)p.x] += NODE_WEIGHT;
+	}
+}
+
+void DensityRenderer::rasterize(Vector2f p, Vector2f q, int rowBegin, int rowEnd)
+{
+	// Clip to the whole grid (Liang-Barsky), so every band walks the same samples
+	float t0 = 0.f, t1 = 1.f;
+	Vector2f d = q - p;
+	auto clip = [&](float den, float num) {
+		if (den == 0.f)
+			return num >= 0.f;
+		float t = num / den;
+		if (den < 0.f) t0 = max(t0, t);
+		else t1 = min(t1, t);
+		return true;
+	};
+	float maxX = width - CLIP_MARGIN, maxY = height - CLIP_MARGIN;
+	if (!clip(-d.x, p.x) || !clip(d.x, maxX - p.x) || !clip(-d.y, p.y) || !clip(d.y, maxY - p.y) || t0 > t1)
+		return;
+	Vector2f a = p + d * t0;
+	Vector2f b = p + d * t1;
+
+	// DDA with one sample per pixel along the major axis
+	Vector2f ab = b - a;
+	int steps = max(1, (int)ceil(max(abs(ab.x), abs(ab.y))));
+	Vector2f step = ab / (float)steps;
+
+	// Only walk the samples that can land in this band
+	int kBegin = 0, kEnd = steps;
+	if (step.y != 0.f) {
+		float k0 = (rowBegin - a.y) / step.y;
+		float k1 = (rowEnd - a.y) / step.y;
+		if (k0 > k1) swap(k0, k1);
+		kBegin = max(kBegin, (int)floor(k0) - 1);
+		kEnd = min(kEnd, (int)ceil(k1) + 1);
+	}
+	for (int k = kBegin; k <= kEnd; ++k) {
+		Vector2f s = a + step * (float)k;
+		int row = (int)s.y;
+		if (row < rowBegin || row >= rowEnd)
+			continue;
+		counts[(size_t)row * width + (size_t)s.x]++;
+	}
+}
+
+int DensityRenderer::level(Uint32 count) const
+{
+	if (maxCount < LEVELS)
+		return count;
+	return (int)((uint64_t)count * (LEVELS - 1) / maxCount);
+}
+
+void DensityRenderer::buildPalette(DensityTransfer transfer)
+{
+	palette.assign(LEVELS, Color::Transparent);
+	if (maxCount == 0)
+		return;
+	int top = level(maxCount);
+
+	if (transfer == LogTransfer) {
+		float denom = log1p((float)maxCount);
+		for (int l = 1; l <= top; ++l) {
+			// count represented by level l
+			float count = maxCount < LEVELS ? l : (float)l * maxCount / (LEVELS - 1);
+			palette[l] = ramp(log1p(count) / denom);
+		}
+		return;
+	}
+
+	// Cumulative distribution of levels over non empty pixels
+	cdf.assign(LEVELS, 0);
+	int bands = bandMax.size();
+	for (int b = 0; b < bands; ++b) {
+		for (int l = 0; l < LEVELS; ++l)
+			cdf[l] += bandLevels[(size_t)b * LEVELS + l];
+	}
+	for (int l = 1; l < LEVELS; ++l)
+		cdf[l] += cdf[l - 1];
+	uint64_t total = cdf[LEVELS - 1];
+	if (total == 0)
+		return;
+	// Start at the lowest occupied level so the sparsest pixels get the first colour of the ramp
+	uint64_t first = 0;
+	for (int l = 0; l < LEVELS && first == 0; ++l)
+		first = cdf[l];
+	for (int l = 1; l <= top; ++l) {
+		float v = total == first ? 1.f : (float)(cdf[l] - first) / (total - first);
+		palette[l] = ramp(v);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Color.hpp>
+
+#include "Edge.hpp"
+
+using namespace std;
+using namespace sf;
+
+// How pixel densities are mapped to colours
+enum DensityTransfer {
+	// log(1 + count), keeps sparse areas visible next to dense ones
+	LogTransfer,
+	// histogram equalization, every colour covers roughly the same number of pixels
+	EqualizeTransfer
+};
+
+/* Aggregate rendering of large graphs
+*
+* Node positions and rasterized edge segments are counted into a per-pixel density grid,
+* the counts are coloured through a transfer function and the result is drawn as a single texture.
+* The grid is split into horizontal bands filled in parallel, each band owns its rows so no locking is needed.
+* Nodes and edges are binned by the bands they touch once per frame, so a band only visits its own.
+*/
+class DensityRenderer : public Drawable
+{
+public:
+	// Rebuild the density texture, 'size' is the size of the render target in pixels
+	void update(Vector2u size, const vector<Vector2f>& positions, const vector<Edge>& edges, DensityTransfer transfer);
+	// Fill the pixel buffer without uploading it to the texture, works without a window
+	void render(Vector2u size, const vector<Vector2f>& positions, const vector<Edge>& edges, DensityTransfer transfer);
+private:
+	void draw(RenderTarget& target, RenderStates states) const override;
+
+	// Sort node and edge indices into the bands they touch
+	void binByBand(int bands, const vector<Vector2f>& positions, const vector<Edge>& edges);
+	// Count the nodes and edge pixels of band b in rows [rowBegin, rowEnd)
+	void accumulate(int b, int rowBegin, int rowEnd, const vector<Vector2f>& positions, const vector<Edge>& edges);
+	// Rasterize segment p-q, counting only pixels in rows [rowBegin, rowEnd)
+	void rasterize(Vector2f p, Vector2f q, int rowBegin, int rowEnd);
+	// Fill 'palette' with the colour of every density level
+	void buildPalette(DensityTransfer transfer);
+	// Density level of a pixel count, levels index into 'palette'
+	int level(Uint32 count) const;
+
+	unsigned width = 0, height = 0;
+	vector<Uint32> counts;
+	vector<Uint8> pixels;
+	// node and edge indices per band, items of band b are [start[b], start[b + 1])
+	vector<int> nodeStart, nodeItems, edgeStart, edgeItems;
+	// band range of every edge, first > last for edges outside the grid
+	vector<pair<int, int>> edgeBands;
+	// highest count in every band
+	vector<Uint32> bandMax;
+	// number of pixels at every level in every band, bandLevels * LEVELS
+	vector<Uint32> bandLevels;
+	// cumulative number of pixels up to every level, for equalization
+	vector<uint64_t> cdf;
+	Uint32 maxCount = 0;
+	vector<Color> palette;
+	Texture texture;
+};
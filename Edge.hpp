@@ -3,14 +3,21 @@
 #include <SFML/System/Vector2.hpp>
 
 using namespace std;
+using namespace sf;
 
 struct Edge {
 	Vector2i nodes;
     float weight;
+    // Graph orders the ends by node, set if that swapped them, so directed edges go from nodes.y to nodes.x
+    bool reversed = false;
 
 	Edge(int node1, int node2, float weight = 1) : nodes({ node1, node2 }), weight(weight) {};
 	Edge(Vector2i nodes, float weight = 1) : nodes(nodes), weight(weight) {};
 
+    // Ends in the order they were given, for directed graphs
+    int source() const { return reversed ? nodes.y : nodes.x; }
+    int target() const { return reversed ? nodes.x : nodes.y; }
+
     // Overloading [] operator
     int operator[](size_t index) const {
         if (index == 0) 
@@ -0,0 +1,242 @@
+#include <cmath>
+#include <algorithm>
+
+#include "EdgeBundling.hpp"
+#include "SpatialGrid.hpp"
+#include "Parallel.hpp"
+
+const float BUNDLING_EPS = 1e-4f;
+
+static float length(Vector2f v) {
+	return sqrt(v.x * v.x + v.y * v.y);
+}
+
+static float dot(Vector2f a, Vector2f b) {
+	return a.x * b.x + a.y * b.y;
+}
+
+// Visibility of edge (q0,q1) from edge (p0,p1): how much of P is covered by the projection of Q
+static float visibility(Vector2f p0, Vector2f p1, Vector2f q0, Vector2f q1) {
+	Vector2f dir = p1 - p0;
+	float len2 = dot(dir, dir);
+	Vector2f i0 = p0 + dir * (dot(q0 - p0, dir) / len2);
+	Vector2f i1 = p0 + dir * (dot(q1 - p0, dir) / len2);
+	float span = length(i1 - i0);
+	if (span < BUNDLING_EPS)
+		return 0.f;
+	Vector2f im = (i0 + i1) / 2.f;
+	Vector2f pm = (p0 + p1) / 2.f;
+	return max(0.f, 1.f - 2.f * length(pm - im) / span);
+}
+
+// Largest length ratio max(|P|,|Q|)/min(|P|,|Q|) whose scale compatibility is still above threshold
+static float maxLengthRatio(float threshold) {
+	auto scale = [](float ratio) {
+		float avg = (1.f + ratio) / 2.f;
+		return 2.f / (avg + ratio / avg);
+	};
+	float lo = 1.f, hi = 1e6f;
+	for (int i = 0; i < 60; ++i) {
+		float mid = (lo + hi) / 2.f;
+		if (scale(mid) >= threshold) lo = mid;
+		else hi = mid;
+	}
+	return lo;
+}
+
+bool EdgeBundler::bundle(const vector<Vector2f>& positions, const vector<Edge>& edges, function<bool()> cancelled)
+{
+	ends.clear();
+	lengths.clear();
+	for (const Edge& e : edges) {
+		ends.push_back(e.nodes);
+		lengths.push_back(length(positions[e[1]] - positions[e[0]]));
+	}
+
+	// Start with straight edges without subdivision points
+	P = 0;
+	points.resize(ends.size() * 2);
+	for (int e = 0; e < ends.size(); ++e) {
+		point(e, 0) = positions[ends[e].x];
+		point(e, 1) = positions[ends[e].y];
+	}
+
+	computeCompatibility();
+
+	float step = params.step;
+	float iterations = float(params.iterations);
+	for (int cycle = 0; cycle < params.cycles; ++cycle) {
+		subdivide(P == 0 ? 1 : P * 2);
+		for (int i = 0; i < int(iterations); ++i) {
+			if (cancelled && cancelled()) {
+				clear();
+				return false;
+			}
+			iterate(step);
+		}
+		step /= 2.f;
+		iterations *= params.iterationRate;
+	}
+	return true;
+}
+
+void EdgeBundler::clear()
+{
+	points.clear();
+	next.clear();
+	compatibleStart.clear();
+	compatible.clear();
+	P = 0;
+}
+
+void EdgeBundler::computeCompatibility()
+{
+	int m = ends.size();
+	vector<Vector2f> mid(m);
+	float maxLength = 0.f;
+	for (int e = 0; e < m; ++e) {
+		mid[e] = (point(e, 0) + point(e, 1)) / 2.f;
+		maxLength = max(maxLength, lengths[e]);
+	}
+
+	// Position compatibility lavg / (lavg + |Pm-Qm|) falls under the threshold once midpoints are further
+	// apart than lavg * (1/threshold - 1), and scale compatibility bounds lavg by the length of P
+	float threshold = params.compatibility;
+	float ratio = maxLengthRatio(threshold);
+	float reach = (1.f + ratio) / 2.f * (1.f / threshold - 1.f);
+
+	SpatialGrid grid;
+	grid.build(mid, max(1.f, maxLength * reach / 4.f));
+
+	vector<vector<Compatible>> perEdge(m);
+	parallelFor(0, m, [&](int e) {
+		float lp = lengths[e];
+		if (lp < BUNDLING_EPS)
+			return;
+		Vector2f p0 = point(e, 0), p1 = point(e, 1);
+		Vector2f dp = p1 - p0;
+		grid.forEachInRadius(mid[e], lp * reach, [&](int f) {
+			float lq = lengths[f];
+			if (f == e || lq < BUNDLING_EPS)
+				return;
+			Vector2f q0 = point(f, 0), q1 = point(f, 1);
+			Vector2f dq = q1 - q0;
+
+			float cosine = dot(dp, dq) / (lp * lq);
+			float angle = abs(cosine);
+			float avg = (lp + lq) / 2.f;
+			float scale = 2.f / (avg / min(lp, lq) + max(lp, lq) / avg);
+			float position = avg / (avg + length(mid[e] - mid[f]));
+			float vis = min(visibility(p0, p1, q0, q1), visibility(q0, q1, p0, p1));
+
+			float c = angle * scale * position * vis;
+			if (c >= threshold)
+				perEdge[e].push_back({ f, c, cosine < 0.f });
+		});
+	}, 16);
+
+	compatibleStart.assign(m + 1, 0);
+	for (int e = 0; e < m; ++e)
+		compatibleStart[e + 1] = compatibleStart[e] + perEdge[e].size();
+	compatible.clear();
+	compatible.reserve(compatibleStart[m]);
+	for (auto& list : perEdge)
+		compatible.insert(compatible.end(), list.begin(), list.end());
+}
+
+void EdgeBundler::subdivide(int newP)
+{
+	int m = ends.size();
+	int oldStride = P + 2;
+	next.resize(size_t(m) * (newP + 2));
+
+	parallelFor(0, m, [&](int e) {
+		const Vector2f* src = &points[size_t(e) * oldStride];
+		Vector2f* dst = &next[size_t(e) * (newP + 2)];
+
+		float polyLength = 0.f;
+		for (int k = 0; k + 1 < oldStride; ++k)
+			polyLength += length(src[k + 1] - src[k]);
+
+		dst[0] = src[0];
+		dst[newP + 1] = src[oldStride - 1];
+
+		// Walk the old polyline placing a point every 'segment' units
+		float segment = polyLength / (newP + 1);
+		int k = 0;
+		float walked = 0.f;
+		for (int j = 1; j <= newP; ++j) {
+			float target = segment * j;
+			while (k + 1 < oldStride - 1 && walked + length(src[k + 1] - src[k]) < target) {
+				walked += length(src[k + 1] - src[k]);
+				k++;
+			}
+			float seg = length(src[k + 1] - src[k]);
+			float t = seg < BUNDLING_EPS ? 0.f : (target - walked) / seg;
+			dst[j] = src[k] + (src[k + 1] - src[k]) * min(1.f, max(0.f, t));
+		}
+	}, 256);
+
+	P = newP;
+	points.swap(next);
+	next.resize(points.size());
+}
+
+void EdgeBundler::iterate(float step)
+{
+	int m = ends.size();
+	int stride = P + 2;
+
+	parallelFor(0, m, [&](int e) {
+		Vector2f* out = &next[size_t(e) * stride];
+		out[0] = point(e, 0);
+		out[P + 1] = point(e, P + 1);
+
+		float kP = params.K / (max(lengths[e], BUNDLING_EPS) * (P + 1));
+		for (int k = 1; k <= P; ++k) {
+			Vector2f p = point(e, k);
+
+			// Spring force keeping the polyline together
+			Vector2f force = (point(e, k - 1) - p + point(e, k + 1) - p) * kP;
+
+			// Electrostatic attraction towards matching points of compatible edges
+			for (int c = compatibleStart[e]; c < compatibleStart[e + 1]; ++c) {
+				const Compatible& other = compatible[c];
+				Vector2f d = point(other.edge, other.flipped ? P + 1 - k : k) - p;
+				float dist = length(d);
+				if (dist > BUNDLING_EPS)
+					force += d * (other.weight / dist);
+			}
+
+			out[k] = p + force * step;
+		}
+	}, 64);
+
+	points.swap(next);
+}
+
+void EdgeBundler::buildVertices(VertexArray& out, const vector<Vector2f>& endOffset, float thickness, Color color) const
+{
+	out.setPrimitiveType(Quads);
+	int stride = P + 2;
+	for (int e = 0; e < ends.size(); ++e) {
+		Vector2f o0 = endOffset[ends[e].x];
+		Vector2f o1 = endOffset[ends[e].y];
+		for (int k = 0; k + 1 < stride; ++k) {
+			float t0 = k / float(stride - 1), t1 = (k + 1) / float(stride - 1);
+			Vector2f a = point(e, k) + o0 * (1.f - t0) + o1 * t0;
+			Vector2f b = point(e, k + 1) + o0 * (1.f - t1) + o1 * t1;
+
+			Vector2f dir = b - a;
+			float len = length(dir);
+			if (len < BUNDLING_EPS)
+				continue;
+			Vector2f offset = Vector2f(-dir.y, dir.x) * (thickness / 2.f / len);
+
+			out.append(Vertex(a + offset, color));
+			out.append(Vertex(b + offset, color));
+			out.append(Vertex(b - offset, color));
+			out.append(Vertex(a - offset, color));
+		}
+	}
+}
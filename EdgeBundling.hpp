@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/Color.hpp>
+
+#include "Edge.hpp"
+
+using namespace std;
+using namespace sf;
+
+// Parameters of force-directed edge bundling (Holten & van Wijk, 2009)
+struct BundlingParams {
+	// number of cycles, every cycle doubles the subdivision points and halves the step
+	int cycles = 6;
+	// iterations in the first cycle
+	int iterations = 60;
+	// iterations are multiplied by this factor every cycle
+	float iterationRate = 2.f / 3.f;
+	// initial step size
+	float step = 0.1f;
+	// global spring constant
+	float K = 0.1f;
+	// edge pairs less compatible than this don't attract each other
+	float compatibility = 0.6f;
+};
+
+/* Force-directed edge bundling
+*
+* Every edge is subdivided into a polyline and the subdivision points of compatible edges
+* (similar angle, length and position, see Holten & van Wijk) attract each other.
+* Compatible pairs are found through a spatial grid over edge midpoints instead of testing all pairs,
+* and each iteration moves the points of all edges in parallel.
+*/
+class EdgeBundler
+{
+public:
+	EdgeBundler(BundlingParams params = BundlingParams()) : params(params) {}
+
+	// Bundle the edges using current node positions
+	// cancelled - polled between iterations, bundling stops early and returns false if it returns true
+	bool bundle(const vector<Vector2f>& positions, const vector<Edge>& edges, function<bool()> cancelled = nullptr);
+	// Drop the bundled polylines (e.g. when nodes have moved)
+	void clear();
+	bool ready() const { return !points.empty(); }
+
+	// Append all polylines as quads to 'out', so they can be drawn with a single draw call
+	// endOffset - per node offset added to the polyline ends (interpolated along the polyline)
+	void buildVertices(VertexArray& out, const vector<Vector2f>& endOffset, float thickness, Color color) const;
+private:
+	// Find compatible edge pairs
+	void computeCompatibility();
+	// Resample every polyline to 'newP' equally spaced subdivision points
+	void subdivide(int newP);
+	// Move subdivision points once, returns nothing, result ends up in 'points'
+	void iterate(float step);
+
+	Vector2f& point(int e, int k) { return points[e * (P + 2) + k]; }
+	const Vector2f& point(int e, int k) const { return points[e * (P + 2) + k]; }
+
+	struct Compatible {
+		int edge;
+		float weight;
+		// edges point in opposite directions, so point k matches point P+1-k
+		bool flipped;
+	};
+
+	BundlingParams params;
+	vector<Vector2i> ends;
+	vector<float> lengths;
+	// subdivision points per edge, not counting the two ends
+	int P = 0;
+	// P+2 points per edge, ends included
+	vector<Vector2f> points;
+	vector<Vector2f> next;
+	// Compatible edges of e are compatible[compatibleStart[e]] .. compatible[compatibleStart[e+1]-1]
+	vector<int> compatibleStart;
+	vector<Compatible> compatible;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cmath>
+#include <SFML/System/Vector2.hpp>
+
+#include "Util.hpp"
+
+using namespace sf;
+using namespace std;
+
+/* Force model policies
+*
+* Graph::forceDirectedStep is templated on one of these, so every model compiles to its own inner loop
+* without branching on the algorithm. A model provides:
+*   repulsive(p1, p2, l, m1, m2) - force on p1 pushing it away from p2, m1 and m2 are node masses (degree + 1)
+*   attractive(p1, p2, l)        - force on p1 pulling it towards p2 along an edge
+*   gravity(p, center, m)        - force pulling p towards the center of the canvas
+*   adaptiveSpeed                - scale displacements by ForceAtlas2 swing/traction speed
+*/
+
+// Fruchterman-Reingold
+// f_rep = l^2 / d, f_attr = d^2 / l
+struct FruchtermanReingoldModel {
+	static constexpr bool adaptiveSpeed = false;
+
+	static Vector2f repulsive(Vector2f p1, Vector2f p2, float l, float, float) {
+		return ::repulsive(p1, p2, l);
+	}
+
+	static Vector2f attractive(Vector2f p1, Vector2f p2, float l) {
+		return ::attractive(p1, p2, l);
+	}
+
+	static Vector2f gravity(Vector2f p, Vector2f center, float) {
+		return ::attractive(p, center, CANVAS_HEIGHT);
+	}
+};
+
+// LinLog, logarithmic attraction as in the LinLog mode of ForceAtlas2, separates clusters more clearly
+// f_rep = l^2 / d, f_attr = l * ln(1 + d / l)
+struct LinLogModel {
+	static constexpr bool adaptiveSpeed = false;
+
+	static Vector2f repulsive(Vector2f p1, Vector2f p2, float l, float, float) {
+		return ::repulsive(p1, p2, l);
+	}
+
+	static Vector2f attractive(Vector2f p1, Vector2f p2, float l) {
+		float dist = max(Euclidian(p1, p2), Eps);
+		Vector2f unit = (p2 - p1) / dist;
+		return unit * (l * log(1.f + dist / l));
+	}
+
+	static Vector2f gravity(Vector2f p, Vector2f center, float) {
+		return ::attractive(p, center, CANVAS_HEIGHT);
+	}
+};
+
+// ForceAtlas2 (Jacomy et al., 2014)
+// f_rep = k_r * m1 * m2 / d, f_attr = d, gravity proportional to mass
+// k_r = l^2 / 16, two leaves balance at distance l / 2 while hubs push each other much further apart
+struct ForceAtlas2Model {
+	static constexpr bool adaptiveSpeed = true;
+
+	static Vector2f repulsive(Vector2f p1, Vector2f p2, float l, float m1, float m2) {
+		float dist = max(Euclidian(p1, p2), Eps);
+		Vector2f unit = (p1 - p2) / dist;
+		return unit * (l * l / 16.f * m1 * m2 / dist);
+	}
+
+	static Vector2f attractive(Vector2f p1, Vector2f p2, float) {
+		return p2 - p1;
+	}
+
+	static Vector2f gravity(Vector2f p, Vector2f center, float m) {
+		return ::attractive(p, center, CANVAS_HEIGHT) * m;
+	}
+};
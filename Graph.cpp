@@ -1,18 +1,23 @@
 #include <vector>
+#include <map>
 #include <algorithm>
 #include <iostream>
 #include <random>
 #include <stdexcept>
 #include <fstream>
+#include <sstream>
+#include <unordered_map>
 #include <regex>
 #include <tuple>
 #include <chrono>
 #include <thread>
+#include <unordered_set>
 
 #include "Graph.hpp"
 #include "Util.hpp"
-#include <SFML/Graphics/Text.hpp>
-#include "Line.hpp"
+#include "ForceModel.hpp"
+#include "Parallel.hpp"
+#include "Allocations.hpp"
 
 # define PI 3.14159265358979323846
 
@@ -24,9 +29,25 @@ struct lesser_first
 	}
 };
 
+// Reorder values so that values[order[k]] ends up at index k, arrays not sized per node are left alone
+template<typename T>
+static void permute(vector<T>& values, const vector<int>& order)
+{
+	if (values.size() != order.size())
+		return;
+	vector<T> permuted;
+	permuted.reserve(order.size());
+	for (int old : order)
+		permuted.push_back(move(values[old]));
+	values.swap(permuted);
+}
+
 Graph::Graph(std::vector<Node>& nodes, std::vector<Edge>& edges) : nodes(nodes), edges(edges), algorithm(None)
 {
 	adjList = vector<list<int>>(nodes.size());
+	positions = vector<Vector2f>(nodes.size());
+	pinned = vector<bool>(nodes.size(), false);
+	localTemp = vector<float>(nodes.size(), 0.f);
 	for (int i = 0; i < nodes.size(); ++i) {
 		this->nodes[i].id = i;
 	}
@@ -36,15 +57,17 @@ Graph::Graph(std::vector<Node>& nodes, std::vector<Edge>& edges) : nodes(nodes),
 			int tmp = e.nodes.x;
 			e.nodes.x = e.nodes.y;
 			e.nodes.y = tmp;
+			e.reversed = !e.reversed;
 		}
 	}
 	// Sort edges 
 	sort(this->edges.begin(), this->edges.end(), lesser_first());
 
 	for (const Edge& e : this->edges) {
-		if (e[0] >= nodes.size() || e[1] >= nodes.size()) {
-			cout << "Invalid edge: " << e << endl;
-			exit(0xDEAD);
+		if (e[0] < 0 || e[0] >= nodes.size() || e[1] >= nodes.size()) {
+			stringstream msg;
+			msg << "Invalid edge: " << e;
+			throw std::invalid_argument(msg.str());
 		}
 		adjList[e[0]].push_back(e[1]);
 		adjList[e[1]].push_back(e[0]);
@@ -59,29 +82,174 @@ Graph::Graph(std::vector<Node>& nodes, std::vector<Edge>& edges) : nodes(nodes),
 	maxWeight = 0.f;
 	for (auto e: this->edges)
 		maxWeight = max(maxWeight, (float)e.weight);
+
+	// Mass used by ForceAtlas2, degree + 1
+	mass = vector<float>(nodes.size());
+	for (int i = 0; i < adjList.size(); i++)
+		mass[i] = adjList[i].size() + 1.f;
+
+	// Weighted attraction is normalized so the average edge keeps its unweighted force
+	float totalWeight = 0.f;
+	for (const Edge& e : this->edges)
+		totalWeight += e.weight;
+	weightScale = totalWeight > 0.f ? this->edges.size() / totalWeight : 1.f;
+
+	// Graphs with edge weights lay out weighted unless told otherwise
+	weighted = any_of(this->edges.begin(), this->edges.end(), [](const Edge& e) { return e.weight != 1.f; });
+	useWeights = weighted;
+
+	rebuildIndex();
 }
 
 void Graph::FruchtermanReingold(FruchtermanParams params) {
+	this->algorithm = Algorithm::FructhermanReingold;
+	setParams(params);
+}
+
+void Graph::LinLog(FruchtermanParams params) {
+	this->algorithm = Algorithm::LinLogAlgorithm;
+	setParams(params);
+}
+
+void Graph::ForceAtlas2(FruchtermanParams params) {
+	this->algorithm = Algorithm::ForceAtlas2Algorithm;
+	setParams(params);
+}
+
+void Graph::StressSGD(FruchtermanParams params) {
+	this->algorithm = Algorithm::StressSGDAlgorithm;
+	setParams(params);
+}
+
+void Graph::initStress() {
+	// Shrink the edge length if the graph would not fit, diameter estimated by a double BFS sweep
+	float l = L;
+	if (!nodes.empty()) {
+		vector<int> dist;
+		bfsDistances(adjList, 0, dist);
+		int far = max_element(dist.begin(), dist.end()) - dist.begin();
+		bfsDistances(adjList, far, dist);
+		int diameter = *max_element(dist.begin(), dist.end());
+		if (diameter > 0)
+			l = min(l, 0.9f * min(width, height) / diameter);
+	}
+	StressParams stressParams;
+	stressParams.seed = seed;
+	stressLayout = StressLayout(stressParams);
+	stressLayout.init(adjList, l);
+}
+
+// Part of the canvas covered by tree layouts
+const float TREE_FILL = 0.9f;
+
+void Graph::Tree(FruchtermanParams params, bool radial) {
+	this->algorithm = radial ? Algorithm::RadialTreeAlgorithm : Algorithm::TreeAlgorithm;
+	setParams(params);
+}
+
+void Graph::Layered(FruchtermanParams params) {
+	this->algorithm = Algorithm::LayeredAlgorithm;
+	setParams(params);
+}
+
+void Graph::setParams(FruchtermanParams params) {
 	this->L = params.L;
 	this->cooling = params.cooling;
-	this->temp = DEFAULT_TEMP;
-	this->algorithm = Algorithm::FructhermanReingold;
+	this->temp = startTemp;
 	this->width = params.W;
 	this->height = params.H;
 	this->done = false;
+	this->speed = 1.f;
+	this->prevForces.clear();
+	history.clear();
+	historyFrame = -1;
+	// Stress terms hold the ideal distances, which scale with L
+	if (algorithm == StressSGDAlgorithm)
+		initStress();
+}
+
+void Graph::setStartTemp(float temp) {
+	startTemp = temp;
+	this->temp = temp;
+}
+
+bool Graph::Weighted() const {
+	return weighted;
+}
+
+void Graph::setUseWeights(bool useWeights) {
+	this->useWeights = useWeights;
+	if (colorCommunities)
+		setColorCommunities(true);
 }
 
 bool Graph::Update()
 {
 	if (!done){
+		if (recordHistory) {
+			if (history.empty())
+				recordFrame(); // layout before the first step
+			else if (historyFrame < history.last())
+				history.truncate(historyFrame);
+		}
+		unsigned long long allocations = allocationCount();
+
 		switch (algorithm) {
 		case Algorithm::FructhermanReingold:
 			iter++;
 			done = fructhermanReingoldStep();
 			break;
+		case Algorithm::LinLogAlgorithm:
+			iter++;
+			done = useWeights ? forceDirectedStep<LinLogModel, true>() : forceDirectedStep<LinLogModel, false>();
+			break;
+		case Algorithm::ForceAtlas2Algorithm:
+			iter++;
+			if (forcesFrame != -1)
+				restorePrevForces();
+			done = useWeights ? forceDirectedStep<ForceAtlas2Model, true>() : forceDirectedStep<ForceAtlas2Model, false>();
+			break;
+		case Algorithm::StressSGDAlgorithm:
+			iter++;
+			done = stressLayout.epoch(positions, pinned, treshold);
+			break;
+		case Algorithm::TreeAlgorithm:
+		case Algorithm::RadialTreeAlgorithm:
+			// Exact layout, done in one step
+			iter++;
+			treeLayout(spanningForest(adjList), { width / 2, height / 2 }, { width * TREE_FILL, height * TREE_FILL },
+				algorithm == Algorithm::RadialTreeAlgorithm, positions);
+			done = true;
+			break;
+		case Algorithm::LayeredAlgorithm: {
+			// Exact layout as well
+			iter++;
+			vector<Vector2i> arcs;
+			arcs.reserve(edges.size());
+			for (const Edge& e : edges)
+				arcs.push_back({ e.source(), e.target() });
+			layeredLayout(nodes.size(), arcs, { width / 2, height / 2 }, { width * TREE_FILL, height * TREE_FILL }, positions);
+			done = true;
+			break;
+		}
 		default:
 			throw std::invalid_argument("Algorithm not configured or not supported");
 		};
+
+		// Canvas neighbours drift apart in memory as nodes move, sort them again now and then
+		if (nodeOrdering == OrderHilbert && !done && ++reorderSteps >= HILBERT_REORDER_STEPS)
+			permuteNodes(hilbertOrder(positions));
+		if (done && noOverlaps)
+			separateNodes();
+		rebuildIndex();
+		stepAllocations = allocationCount() - allocations;
+		dirty = true;
+		if (recordHistory)
+			recordFrame();
+		if (done)
+			settling = false;
+		if (done && bundleEdges)
+			startBundling();
 	}
 
 	return !done;
@@ -89,32 +257,185 @@ bool Graph::Update()
 
 void Graph::Reset() {
 	done = false;
-	temp = DEFAULT_TEMP;
+	temp = startTemp;
+	speed = 1.f;
+	prevForces.clear();
+	forcesFrame = -1;
+	stressLayout.restart();
+	// Pins belong to the run that is being restarted
+	pinned.assign(nodes.size(), false);
+	clearBundles();
+	history.clear();
+	historyFrame = -1;
+	dirty = true;
+}
+
+void Graph::setRecordHistory(bool recordHistory) {
+	this->recordHistory = recordHistory;
+	history.clear();
+	historyFrame = -1;
+}
+
+void Graph::recordFrame() {
+	LayoutHistory::State state = { iter, temp, stressLayout.epochsDone(), speed };
+	if (nodeOrdering == OrderFile) {
+		history.record(positions, state);
+		historyFrame = history.last();
+		return;
+	}
+	byId.resize(nodes.size());
+	for (int i = 0; i < nodes.size(); ++i)
+		byId[nodes[i].id] = positions[i];
+	history.record(byId, state);
+	historyFrame = history.last();
+}
+
+LayoutHistory::State Graph::restoreFrame(int frame) {
+	if (nodeOrdering == OrderFile)
+		return history.restore(frame, positions);
+	LayoutHistory::State state = history.restore(frame, byId);
+	for (int i = 0; i < nodes.size(); ++i)
+		positions[i] = byId[nodes[i].id];
+	return state;
+}
+
+void Graph::Rewind(int frame) {
+	if (history.empty())
+		return;
+	frame = min(max(frame, history.first()), history.last());
+	LayoutHistory::State state = restoreFrame(frame);
+	iter = state.iteration;
+	temp = state.temp;
+	stressLayout.setEpoch(state.epoch);
+	speed = state.speed;
+	// ForceAtlas2 also needs the forces of the step before, they are recomputed only if stepping continues
+	prevForces.clear();
+	forcesFrame = frame > history.first() ? frame - 1 : -1;
+	historyFrame = frame;
+	// Stepping may continue from here, a converged layout is the last frame anyway
+	done = false;
+	settling = false;
+	clearBundles();
+	rebuildIndex();
+	dirty = true;
+}
+
+void Graph::restorePrevForces() {
+	// The history may have been cleared since
+	if (history.empty() || forcesFrame < history.first() || forcesFrame > history.last()) {
+		forcesFrame = -1;
+		return;
+	}
+	vector<Vector2f> current = positions;
+	restoreFrame(forcesFrame);
+	if (useWeights)
+		computeForces<ForceAtlas2Model, true>();
+	else
+		computeForces<ForceAtlas2Model, false>();
+	prevForces = forces;
+	positions.swap(current);
+	forcesFrame = -1;
+}
+
+int Graph::HistoryFirst() const {
+	return history.first();
+}
+
+int Graph::HistoryLast() const {
+	return history.last();
+}
+
+int Graph::HistoryFrame() const {
+	return historyFrame;
 }
 
 bool Graph::fructhermanReingoldStep()
+{
+	if (useWeights)
+		return forceDirectedStep<FruchtermanReingoldModel, true>();
+	return forceDirectedStep<FruchtermanReingoldModel, false>();
+}
+
+// From this many nodes on repulsion is computed row by row on all cores
+const int PARALLEL_MIN_NODES = 1000;
+
+template<typename Model, bool Weighted>
+bool Graph::forceDirectedStep()
 {
 	bool equilibrium = true;
-	vector<Vector2f> forces(nodes.size(), { 0, 0 });
-	
-	// Iterate through each node pair and calculate repulsive forces
+	computeForces<Model, Weighted>();
+
+	if constexpr (Model::adaptiveSpeed)
+		adaptSpeed(forces);
+
+	// Apply forces
 	for (int i = 0; i < nodes.size(); ++i) {
-		for (int j = i + 1; j < nodes.size(); ++j) {
-			Vector2f rep = repulsive(nodes[i].pos, nodes[j].pos, L);
+		int signX = (forces[i].x > 0.f) - (forces[i].x < 0.f);
+		int signY = (forces[i].y > 0.f) - (forces[i].y < 0.f);
+
+		// Use temperature to limit displacement, reheated nodes may move further
+		float t = max(temp, localTemp[i]);
+		localTemp[i] *= cooling;
+		forces[i].x = min(abs(forces[i].x), t) * signX;
+		forces[i].y = min(abs(forces[i].y), t) * signY;
 
-			if (DEBUGGING)
-				cout << "Repulsive force " << i << "<->" << j << ": (" << rep.x << "," << rep.y << ")" << endl;
+		if (pinned[i])
+			continue;
 
-			forces[i] += rep;
-			forces[j] -= rep;
+		if ((abs(forces[i].x) > treshold) || (abs(forces[i].y) > treshold)) {
+			equilibrium = false;
+		}
+		positions[i] += forces[i];
+		keepInside(i);
+	}
+
+	temp *= cooling;
+
+	if (DEBUGGING)
+		cout << "Temp: " << temp << endl;
+
+	return equilibrium;
+}
+
+template<typename Model, bool Weighted>
+void Graph::computeForces()
+{
+	forces.assign(nodes.size(), { 0, 0 });
+
+	int n = nodes.size();
+	if (n >= PARALLEL_MIN_NODES) {
+		// Large graphs: every node sums its own row of repulsive forces, rows run in parallel
+		parallelFor(0, n, [&](int i) {
+			Vector2f sum = { 0, 0 };
+			for (int j = 0; j < n; ++j) {
+				if (j != i)
+					sum += Model::repulsive(positions[i], positions[j], L, mass[i], mass[j]);
+			}
+			forces[i] = sum;
+		}, 16);
+	}
+	else {
+		// Iterate through each node pair and calculate repulsive forces
+		for (int i = 0; i < nodes.size(); ++i) {
+			for (int j = i + 1; j < nodes.size(); ++j) {
+				Vector2f rep = Model::repulsive(positions[i], positions[j], L, mass[i], mass[j]);
+
+				if (DEBUGGING)
+					cout << "Repulsive force " << i << "<->" << j << ": (" << rep.x << "," << rep.y << ")" << endl;
+
+				forces[i] += rep;
+				forces[j] -= rep;
+			}
 		}
 	}
 
 	// Iterate through all edges and calculate attractive forces
-	for (auto e : edges) {
+	for (const Edge& e : edges) {
 		int i = e.nodes.x;
 		int j = e.nodes.y;
-		Vector2f attr = attractive(nodes[i].pos, nodes[j].pos, L);
+		Vector2f attr = Model::attractive(positions[i], positions[j], L);
+		if (Weighted)
+			attr *= e.weight * weightScale;
 		
 		if (DEBUGGING)
 			cout << "Attractive force " << i << "<->" << j << ": (" << attr.x << "," << attr.y << ")" << endl;
@@ -123,110 +444,719 @@ bool Graph::fructhermanReingoldStep()
 		forces[j] -= attr;
 	}
 
-	// Apply forces
 	for (int i = 0; i < nodes.size(); ++i) {
 		// Scale forces to number of nodes
 		forces[i] /= float(nodes.size());
 		
 		// add attractive force, pulling node to the center the further its away
 		Vector2f center = { width / 2, height / 2 };
-		Vector2f centerPull = attractive(nodes[i].pos, center, CANVAS_HEIGHT) / float(nodes.size());
+		Vector2f centerPull = Model::gravity(positions[i], center, mass[i]) / float(nodes.size());
 		forces[i] += centerPull * Gravity;
+	}
+}
 
-		int signX = (forces[i].x > 0.f) - (forces[i].x < 0.f);
-		int signY = (forces[i].y > 0.f) - (forces[i].y < 0.f);
+// ForceAtlas2 adaptive speed parameters
+const float SPEED_TOLERANCE = 1.f;
+const float SPEED_KS = 0.1f;
+const float SPEED_KSMAX = 10.f;
+const float SPEED_MAX_RISE = 1.5f;
 
-		// Use temperature to limit displacement
-		forces[i].x = min(abs(forces[i].x), temp) * signX;
-		forces[i].y = min(abs(forces[i].y), temp) * signY;
+void Graph::adaptSpeed(vector<Vector2f>& forces)
+{
+	if (prevForces.size() != forces.size())
+		prevForces.assign(forces.size(), { 0, 0 });
 
-		if ((abs(forces[i].x) > treshold) || (abs(forces[i].y) > treshold)) {
-			equilibrium = false;
-		}
-		nodes[i].pos += forces[i];
+	// Swing: how much a node's force changed direction since last step, traction: how consistent it is
+	swing.resize(forces.size());
+	float globalSwing = 0.f, globalTraction = 0.f;
+	for (int i = 0; i < forces.size(); ++i) {
+		swing[i] = Euclidian(forces[i], prevForces[i]);
+		float traction = Euclidian(forces[i], -prevForces[i]) / 2.f;
+		globalSwing += mass[i] * swing[i];
+		globalTraction += mass[i] * traction;
+	}
 
-		// Limit the node to be inside the window
-		nodes[i].pos.x = max(nodes[i].pos.x, float(nodes[i].shape.getRadius()));
-		nodes[i].pos.x = min(nodes[i].pos.x, float(width) - 2 * nodes[i].shape.getRadius());
+	float target = SPEED_TOLERANCE * globalTraction / max(globalSwing, Eps);
+	speed = min(target, speed * SPEED_MAX_RISE);
 
-		nodes[i].pos.y = max(nodes[i].pos.y, float(nodes[i].shape.getRadius()));
-		nodes[i].pos.y = min(nodes[i].pos.y, float(height) - 2 * nodes[i].shape.getRadius());
-		 
-		nodes[i].shape.setPosition(nodes[i].pos);
+	for (int i = 0; i < forces.size(); ++i) {
+		prevForces[i] = forces[i];
+		float nodeSpeed = SPEED_KS * speed / (1.f + speed * sqrt(swing[i]));
+		float len = max(Euclidian(forces[i], { 0, 0 }), Eps);
+		nodeSpeed = min(nodeSpeed, SPEED_KSMAX / len);
+		forces[i] *= nodeSpeed;
 	}
+}
 
-	temp *= cooling;
+void Graph::setNodeDimensions(float nodeMin, float nodeMax)
+{
+	this->nodeMin = nodeMin;
+	this->nodeMax = nodeMax;
+	resizeNodes();
+	dirty = true;
+}
 
-	if (DEBUGGING)
-		cout << "Temp: " << temp << endl;
+void Graph::setShowLabels(bool showLabels)
+{
+	this->showLabels = showLabels;
+	dirty = true;
+}
 
-	return equilibrium;
+void Graph::setBundleEdges(bool bundleEdges)
+{
+	this->bundleEdges = bundleEdges;
+	if (!bundleEdges)
+		clearBundles();
+	else if (done && !bundler.ready() && !bundlingJob)
+		startBundling();
+	dirty = true;
 }
 
-const float thickness = 1.5f;
+void Graph::setNodeSizing(NodeSizing nodeSizing)
+{
+	this->nodeSizing = nodeSizing;
+	updateImportance();
+	resizeNodes();
+	dirty = true;
+}
 
-void Graph::draw(tgui::CanvasSFML::Ptr &target, sf::Font font)
+void Graph::setRemoveOverlaps(bool removeOverlaps)
 {
-	for (const Edge& e : edges) {
-		auto node1 = nodes[e[0]].shape;
-		auto node2 = nodes[e[1]].shape;
-		target->draw(sfLine(node1.getPosition() + node1.getOrigin(), node2.getPosition() + node2.getOrigin(), thickness));
+	noOverlaps = removeOverlaps;
+	if (!done || settling)
+		return;
+	if (noOverlaps)
+		separateNodes();
+	else if (positions == adjusted)
+		positions = unadjusted;
+	rebuildIndex();
+	if (bundleEdges)
+		startBundling();
+	dirty = true;
+}
+
+float Graph::nodeRadius(int i) const
+{
+	// scale node size based on degree, or on centrality once it is computed
+	float scale = importance.empty() ? adjList[i].size() / (float)maxDegree : importance[i];
+	return nodeMin + (nodeMax - nodeMin) * scale;
+}
+
+// Space kept between separated nodes
+const float OVERLAP_GAP = 1.f;
+
+void Graph::separateNodes()
+{
+	int n = nodes.size();
+	unadjusted = positions;
+	// Radial trees keep their levels on circles, pushing nodes apart would break them
+	if (algorithm == RadialTreeAlgorithm) {
+		adjusted = positions;
+		return;
 	}
 
-	for (int i = 0; i < nodes.size(); ++i) {
-		// scale node size based on degree
-		float scaledR = nodeMin + (nodeMax - nodeMin) * (adjList[i].size() / (float)maxDegree);
-		nodes[i].shape.setOrigin(scaledR / 2, scaledR / 2);
-		nodes[i].shape.setRadius(scaledR);
-		target->draw(nodes[i].shape);
-
-		if (showLabels) {
-			sf::Text label{ nodes[i].label, font};
-			label.setFillColor(sf::Color::Red);
-			label.setCharacterSize(18);
-			FloatRect numRect = label.getGlobalBounds();
-			Vector2f numRectCenter(numRect.width / 2.0f + numRect.left, numRect.height / 2.0f + numRect.top);
-			label.setOrigin(numRectCenter);
-			label.setPosition(nodes[i].pos.x, nodes[i].pos.y);
-			target->draw(label);
+	// Circles are drawn with their center half a radius off the position, see updateShape()
+	vector<float> radii(n);
+	vector<Vector2f> circles(n);
+	for (int i = 0; i < n; ++i) {
+		radii[i] = nodeRadius(i);
+		circles[i] = positions[i] + Vector2f(radii[i] / 2, radii[i] / 2);
+	}
+	// Tree and layered layouts keep their levels as rows
+	bool rows = algorithm == TreeAlgorithm || algorithm == LayeredAlgorithm;
+	removeOverlaps(circles, radii, pinned, FloatRect(0, 0, width, height), rows, OVERLAP_GAP);
+
+	for (int i = 0; i < n; ++i)
+		positions[i] = circles[i] - Vector2f(radii[i] / 2, radii[i] / 2);
+	adjusted = positions;
+	dirty = true;
+}
+
+void Graph::resizeNodes()
+{
+	if (!noOverlaps || !done || settling)
+		return;
+	// Nodes not moved since the last removal start from the layout again, so shrinking nodes move back
+	if (positions == adjusted)
+		positions = unadjusted;
+	separateNodes();
+	rebuildIndex();
+	if (bundleEdges)
+		startBundling();
+}
+
+void Graph::setColorCommunities(bool colorCommunities)
+{
+	this->colorCommunities = colorCommunities;
+	if (colorCommunities)
+		DetectCommunities();
+	dirty = true;
+}
+
+void Graph::setRenderMode(RenderMode renderMode, DensityTransfer transfer)
+{
+	this->renderMode = renderMode;
+	this->densityTransfer = transfer;
+	slowFrames = 0;
+	densityLatched = false;
+	dirty = true;
+}
+
+bool Graph::DensityView() const
+{
+	if (renderMode == RenderAuto)
+		return densityLatched || nodes.size() >= DENSITY_MIN_NODES;
+	return renderMode == RenderDensity;
+}
+
+// Reheated nodes start with this temperature, their neighbours with half of it and so on
+const float REHEAT_TEMP = DEFAULT_TEMP / 4;
+const int REHEAT_DEPTH = 2;
+
+void Graph::rebuildIndex()
+{
+	nodeIndex.build(positions, max(2 * nodeMax, 4.f));
+}
+
+int Graph::pick(Vector2f p) const
+{
+	// Nodes are drawn centered at pos + origin, origin being at most nodeMax/2 in each direction
+	int best = -1;
+	float bestDist = 0.f;
+	nodeIndex.forEachInRadius(p, 2 * nodeMax, [&](int i) {
+		Vector2f center = positions[i] + nodes[i].shape.getOrigin();
+		float r = nodes[i].shape.getRadius();
+		float d = sqrt((center.x - p.x) * (center.x - p.x) + (center.y - p.y) * (center.y - p.y));
+		if (d <= r && (best == -1 || d < bestDist)) {
+			best = i;
+			bestDist = d;
 		}
+	});
+	return best;
+}
 
+void Graph::setHovered(int i)
+{
+	if (i != hovered)
+		dirty = true;
+	hovered = i;
+}
+
+void Graph::setSelected(int i)
+{
+	if (i != selected)
+		dirty = true;
+	selected = i;
+}
+
+int Graph::Selected() const
+{
+	return selected;
+}
+
+void Graph::dragNode(int i, Vector2f p)
+{
+	Vector2f& pos = positions[i];
+	pos = p - nodes[i].shape.getOrigin();
+	keepInside(i);
+	nodeIndex.move(i, pos);
+
+	pinned[i] = true;
+	reheat(i);
+	clearBundles();
+	dirty = true;
+
+	// A converged layout resumes stepping until the neighbourhood settles again
+	if (done) {
+		done = false;
+		settling = true;
 	}
 }
 
-void Graph::setNodeDimensions(float nodeMin, float nodeMax)
+void Graph::keepInside(int i)
 {
-	this->nodeMin = nodeMin;
-	this->nodeMax = nodeMax;
+	// Limit the node to be inside the window
+	float r = nodes[i].shape.getRadius();
+	positions[i].x = min(max(positions[i].x, r), width - 2 * r);
+	positions[i].y = min(max(positions[i].y, r), height - 2 * r);
 }
 
-void Graph::setShowLabels(bool showLabels)
+void Graph::unpin(int i)
 {
-	this->showLabels = showLabels;
+	pinned[i] = false;
+	reheat(i);
+	dirty = true;
+	if (done) {
+		done = false;
+		settling = true;
+	}
 }
 
-void Graph::RandomLayout(Vector2f pos, float L) {
-	for (Node& n : nodes) {
-		n.pos = { pos.x + generateRandomNumber(-L, L), pos.y + generateRandomNumber(-L, L) };
-		n.shape.setPosition(n.pos);
+bool Graph::Dirty() const
+{
+	return dirty;
+}
+
+unsigned long long Graph::StepAllocations() const
+{
+	return stepAllocations;
+}
+
+unsigned long long Graph::FrameAllocations() const
+{
+	return frameAllocations;
+}
+
+bool Graph::Settling() const
+{
+	return settling;
+}
+
+void Graph::reheat(int i)
+{
+	// BFS up to REHEAT_DEPTH hops from i
+	vector<int> frontier = { i }, next;
+	unordered_set<int> visited = { i };
+	float t = REHEAT_TEMP;
+	localTemp[i] = max(localTemp[i], t);
+	for (int depth = 0; depth < REHEAT_DEPTH; ++depth) {
+		t /= 2;
+		next.clear();
+		for (int u : frontier) {
+			for (int v : adjList[u]) {
+				if (!visited.insert(v).second)
+					continue;
+				localTemp[v] = max(localTemp[v], t);
+				next.push_back(v);
+			}
+		}
+		frontier.swap(next);
+	}
+}
+
+void Graph::setNodeOrdering(NodeOrdering ordering)
+{
+	nodeOrdering = ordering;
+	int n = nodes.size();
+	if (n == 0)
+		return;
+#ifdef DEBUG
+	auto start = chrono::steady_clock::now();
+	double spanBefore = edgeSpan(adjList);
+#endif
+	vector<int> order(n);
+	if (ordering == OrderRCM)
+		order = reverseCuthillMcKee(adjList);
+	else if (ordering == OrderHilbert)
+		order = hilbertOrder(positions);
+	else {
+		for (int i = 0; i < n; ++i)
+			order[nodes[i].id] = i;
 	}
+	permuteNodes(order);
+#ifdef DEBUG
+	auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+	DBG("Nodes reordered in " << ms.count() << " ms, mean edge span " << spanBefore << " -> " << edgeSpan(adjList));
+#endif
+}
+
+NodeOrdering Graph::Ordering() const
+{
+	return nodeOrdering;
+}
+
+void Graph::permuteNodes(const vector<int>& order)
+{
+	int n = nodes.size();
+	vector<int> rank(n);
+	for (int k = 0; k < n; ++k)
+		rank[order[k]] = k;
+
+	permute(nodes, order);
+	permute(positions, order);
+	permute(mass, order);
+	permute(prevForces, order);
+	permute(pinned, order);
+	permute(localTemp, order);
+	permute(importance, order);
+	permute(unadjusted, order);
+	permute(adjusted, order);
+	permute(communities.of, order);
+	permute(centrality.betweenness, order);
+	permute(centrality.closeness, order);
+	permute(labelTexts, order);
+	stressLayout.renumber(rank);
+	if (hovered != -1)
+		hovered = rank[hovered];
+	if (selected != -1)
+		selected = rank[selected];
 
+	// Ends stay ordered by file id like the constructor leaves them, 'reversed' keeps the direction.
+	// Edges are sorted by their lower end so the edge loop walks nodes in memory order
+	for (Edge& e : edges) {
+		int a = rank[e[0]], b = rank[e[1]];
+		bool swapped = nodes[a].id > nodes[b].id;
+		e.nodes = swapped ? Vector2i(b, a) : Vector2i(a, b);
+		e.reversed = e.reversed != swapped;
+	}
+	sort(edges.begin(), edges.end(), [](const Edge& e1, const Edge& e2) {
+		return make_pair(min(e1[0], e1[1]), max(e1[0], e1[1])) < make_pair(min(e2[0], e2[1]), max(e2[0], e2[1]));
+	});
+	// Rebuilt rather than renumbered, so list nodes are allocated in the new order as well
+	adjList.assign(n, list<int>());
+	for (const Edge& e : edges) {
+		adjList[e[0]].push_back(e[1]);
+		adjList[e[1]].push_back(e[0]);
+	}
+
+	// Bundles are per edge
+	if (bundleEdges && done)
+		startBundling();
+	else
+		clearBundles();
+	reorderSteps = 0;
+	rebuildIndex();
+	dirty = true;
+}
+
+// Random number streams of the initial layouts
+const uint32_t RANDOM_STREAM = 0, CIRCULAR_STREAM = 1, COMMUNITY_STREAM = 2;
+// Nodes per task when initial positions are filled in parallel
+const int INIT_CHUNK = 4096;
+
+void Graph::setSeed(unsigned seed) {
+	this->seed = seed;
+}
+
+unsigned Graph::Seed() const {
+	return seed;
+}
+
+void Graph::RandomLayout(Vector2f pos, float L) {
+	parallelFor(0, (int)positions.size(), [&](int i) {
+		array<float, 4> u = uniform4(seed, nodes[i].id, RANDOM_STREAM);
+		positions[i] = { pos.x + L * (2 * u[0] - 1), pos.y + L * (2 * u[1] - 1) };
+	}, INIT_CHUNK);
+	startTemp = DEFAULT_TEMP;
+	clearBundles();
+	rebuildIndex();
+	dirty = true;
 };
 
 void Graph::RandomCircularLayout(Vector2f pos, float R) {
-	for (Node& n : nodes) {
-		float random = generateRandomNumber(0, 1);
-		float angle = random * 2 * PI;
-		n.pos = { pos.x + R * cos(angle), pos.y + R * sin(angle) };
-		n.shape.setPosition(n.pos);
+	parallelFor(0, (int)positions.size(), [&](int i) {
+		float angle = uniform4(seed, nodes[i].id, CIRCULAR_STREAM)[0] * 2 * PI;
+		positions[i] = { pos.x + R * cos(angle), pos.y + R * sin(angle) };
+	}, INIT_CHUNK);
+	startTemp = DEFAULT_TEMP;
+	clearBundles();
+	rebuildIndex();
+	dirty = true;
+};
+
+void Graph::CommunityLayout(Vector2f pos, float R) {
+	const Communities& c = DetectCommunities();
+	int n = nodes.size();
+	if (n == 0)
+		return;
+
+	// Every community gets a disk with area proportional to its size
+	vector<float> radius(c.count());
+	for (int k = 0; k < c.count(); ++k)
+		radius[k] = R * sqrt(c.sizes[k] / (float)n);
+
+	// Disk centers come from a layout of the community graph, so connected communities end up next to each other
+	vector<Vector2f> centers(c.count(), pos);
+	if (c.count() > 1) {
+		vector<Node> communityNodes;
+		for (int k = 0; k < c.count(); ++k)
+			communityNodes.push_back(Node::from_id(k));
+		map<pair<int, int>, float> links;
+		for (const Edge& e : edges) {
+			int a = c.of[e[0]], b = c.of[e[1]];
+			if (a != b)
+				links[{ min(a, b), max(a, b) }] += 1.f;
+		}
+		vector<Edge> communityEdges;
+		for (auto& [ends, weight] : links)
+			communityEdges.push_back(Edge(ends.first, ends.second, weight));
+
+		Graph quotient(communityNodes, communityEdges);
+		quotient.setSeed(seed);
+		quotient.RandomCircularLayout(pos, R);
+		quotient.setUseWeights(true);
+		quotient.FruchtermanReingold(calcFruchtParams(c.count()));
+		while (quotient.Update());
+
+		// Fit the centers into the circle
+		Vector2f mean = { 0, 0 };
+		for (const Vector2f& p : quotient.positions)
+			mean += p / (float)c.count();
+		float spread = 0.f;
+		for (const Vector2f& p : quotient.positions)
+			spread = max(spread, Euclidian(p, mean));
+		float scale = spread > 0.f ? max(R - radius[0], R / 2) / spread : 0.f;
+		for (int k = 0; k < c.count(); ++k)
+			centers[k] = pos + (quotient.positions[k] - mean) * scale;
 	}
 
-};
+	parallelFor(0, n, [&](int i) {
+		int k = c.of[i];
+		// uniform in the disk
+		array<float, 4> u = uniform4(seed, nodes[i].id, COMMUNITY_STREAM);
+		float r = radius[k] * sqrt(u[0]);
+		float angle = u[1] * 2 * PI;
+		positions[i] = { centers[k].x + r * cos(angle), centers[k].y + r * sin(angle) };
+	}, INIT_CHUNK);
+	// Nodes already start near their final region, so they don't need to travel as far
+	startTemp = SEEDED_TEMP;
+	clearBundles();
+	rebuildIndex();
+	dirty = true;
+}
+
+void Graph::SpanningTreeLayout(Vector2f pos, float R) {
+	treeLayout(spanningForest(adjList), pos, { 2 * R, 2 * R }, true, positions);
+	// Nodes start close to their final place, so they don't need to travel as far
+	startTemp = SEEDED_TEMP;
+	clearBundles();
+	rebuildIndex();
+	dirty = true;
+}
+
+bool Graph::IsForest() const
+{
+	return isForest(nodes.size(), edges);
+}
+
+bool Graph::IsDirected() const
+{
+	return directed;
+}
+
+// Cached graphs sharing fewer edges are not used as a starting layout
+const float WARM_START_SIMILARITY = 0.5f;
+// Random number stream of nodes missing from a warm start layout
+const uint32_t WARM_START_STREAM = 3;
+
+uint64_t Graph::LayoutKey() const
+{
+	// Edges in file numbering, summed so the order of nodes and edges in memory doesn't matter
+	uint64_t h = hashMix(nodes.size() * 2 + directed);
+	uint64_t sum = 0;
+	for (const Edge& e : edges) {
+		// Directed edges count with their direction
+		int a = nodes[e[0]].id, b = nodes[e[1]].id;
+		if (directed && e.reversed)
+			swap(a, b);
+		struct { int a, b; float w; } raw = { a, b, e.weight };
+		sum += hashBytes(&raw, sizeof(raw));
+	}
+	h = hashMix(h ^ sum);
+	float settings[] = { (float)algorithm, L, cooling, width, height, (float)useWeights };
+	return hashBytes(settings, sizeof(settings), h);
+}
+
+LayoutCache::Signature Graph::cacheSignature() const
+{
+	vector<uint64_t> labelHashes(nodes.size());
+	for (int i = 0; i < nodes.size(); ++i)
+		labelHashes[i] = hashBytes(nodes[i].label.data(), nodes[i].label.size());
+	vector<Vector2i> ends(edges.size());
+	for (int k = 0; k < edges.size(); ++k)
+		ends[k] = directed ? Vector2i(edges[k].source(), edges[k].target()) : edges[k].nodes;
+	return LayoutCache::signature(labelHashes, ends, directed);
+}
+
+CacheUse Graph::RestoreLayout(LayoutCache& cache, float* similarity)
+{
+	int n = nodes.size();
+	vector<Vector2f> cached;
+	if (cache.find(LayoutKey(), cached) && cached.size() == n) {
+		// Cached in file order
+		for (int i = 0; i < n; ++i)
+			positions[i] = cached[nodes[i].id];
+		done = true;
+		if (noOverlaps)
+			separateNodes();
+		rebuildIndex();
+		dirty = true;
+		if (bundleEdges)
+			startBundling();
+		return CacheExact;
+	}
+
+	vector<string> labels;
+	float found;
+	if (!cache.findNearest(cacheSignature(), algorithm, WARM_START_SIMILARITY, labels, cached, found))
+		return CacheMiss;
+	if (similarity)
+		*similarity = found;
+
+	// Nodes are matched by label
+	unordered_map<string, int> index;
+	for (int i = 0; i < n; ++i)
+		index.emplace(nodes[i].label, i);
+	vector<bool> placed(n, false);
+	for (int k = 0; k < labels.size(); ++k) {
+		auto it = index.find(labels[k]);
+		if (it != index.end() && !placed[it->second]) {
+			positions[it->second] = cached[k];
+			placed[it->second] = true;
+		}
+	}
+	// New nodes start next to their placed neighbours, nodes without any keep their initial place
+	for (int i = 0; i < n; ++i) {
+		if (placed[i])
+			continue;
+		Vector2f sum = { 0, 0 };
+		int count = 0;
+		for (int j : adjList[i]) {
+			if (placed[j]) {
+				sum += positions[j];
+				count++;
+			}
+		}
+		if (count > 0) {
+			array<float, 4> u = uniform4(seed, nodes[i].id, WARM_START_STREAM);
+			positions[i] = sum / (float)count + Vector2f(u[0] - 0.5f, u[1] - 0.5f) * L;
+			placed[i] = true;
+		}
+	}
+
+	startTemp = SEEDED_TEMP;
+	temp = startTemp;
+	clearBundles();
+	rebuildIndex();
+	dirty = true;
+	return CacheWarmStart;
+}
+
+void Graph::StoreLayout(LayoutCache& cache) const
+{
+	// Overlap removal depends on node sizes, it is done again after restoring
+	bool separated = noOverlaps && !adjusted.empty() && positions == adjusted;
+	const vector<Vector2f>& layout = separated ? unadjusted : positions;
+	// File order, so the entry doesn't depend on how nodes were reordered
+	vector<string> labels(nodes.size());
+	vector<Vector2f> stored(nodes.size());
+	for (int i = 0; i < nodes.size(); ++i) {
+		labels[nodes[i].id] = nodes[i].label;
+		stored[nodes[i].id] = layout[i];
+	}
+	cache.store(LayoutKey(), cacheSignature(), algorithm, labels, stored);
+}
+
+void Graph::ComputeCentrality()
+{
+	auto job = make_shared<CentralityJob>();
+	for (const Node& node : nodes)
+		job->ids.push_back(node.id);
+	centralityJob = job;
+	int samples = nodes.size() > EXACT_CENTRALITY_NODES ? CENTRALITY_SAMPLES : 0;
+	// Submitted outside any group, so only pool workers run it and the GUI thread waiting in a parallelFor never does
+	ThreadPool::global().submit([job, adjList = adjList, samples]() {
+		auto start = chrono::steady_clock::now();
+		// The graph dropped the job (e.g. another graph was loaded) once this task holds the only reference
+		bool finished = computeCentrality(adjList, job->result, samples, [&job]() { return job.use_count() == 1; });
+		if (finished) {
+			auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+			cout << "Centrality of " << adjList.size() << " nodes " << (job->result.exact ? "" : "(sampled) ")
+				<< "computed in " << ms.count() << " ms" << endl;
+		}
+		job->ready = finished;
+	});
+}
+
+void Graph::startBundling()
+{
+	bundler.clear();
+	auto job = make_shared<BundlingJob>();
+	bundlingJob = job;
+	ThreadPool::global().submit([job, positions = positions, edges = edges]() {
+		// Stops early once the graph dropped the job, e.g. because nodes moved again
+		job->ready = job->result.bundle(positions, edges, [&job]() { return job.use_count() == 1; });
+	});
+}
+
+void Graph::clearBundles()
+{
+	bundler.clear();
+	bundlingJob.reset();
+}
+
+bool Graph::PollBackground()
+{
+	bool running = false;
+	if (bundlingJob) {
+		if (bundlingJob->ready) {
+			bundler = move(bundlingJob->result);
+			bundlingJob.reset();
+			dirty = true;
+		}
+		else
+			running = true;
+	}
+	if (!centralityJob)
+		return running;
+	if (!centralityJob->ready)
+		return true;
+	centrality = move(centralityJob->result);
+	// Nodes reordered while the job ran
+	const vector<int>& ids = centralityJob->ids;
+	for (int i = 0; i < nodes.size(); ++i) {
+		if (ids[i] != nodes[i].id) {
+			vector<int> rank(nodes.size()), order(nodes.size());
+			for (int k = 0; k < nodes.size(); ++k)
+				rank[ids[k]] = k;
+			for (int k = 0; k < nodes.size(); ++k)
+				order[k] = rank[nodes[k].id];
+			permute(centrality.betweenness, order);
+			permute(centrality.closeness, order);
+			break;
+		}
+	}
+	centralityJob.reset();
+	updateImportance();
+	resizeNodes();
+	return false;
+}
+
+void Graph::updateImportance()
+{
+	const vector<float>& values = nodeSizing == SizeByBetweenness ? centrality.betweenness : centrality.closeness;
+	if (nodeSizing == SizeByDegree || values.size() != nodes.size()) {
+		importance.clear();
+		return;
+	}
+	float top = *max_element(values.begin(), values.end());
+	importance.resize(nodes.size());
+	for (int i = 0; i < nodes.size(); ++i)
+		importance[i] = top > 0.f ? values[i] / top : 0.f;
+	dirty = true;
+}
+
+const Communities& Graph::DetectCommunities(function<bool()> cancelled)
+{
+	if (communities.of.size() != nodes.size() || communitiesWeighted != useWeights) {
+		Communities found = louvain(nodes.size(), edges, useWeights, 1., cancelled);
+		if (cancelled && cancelled())
+			return communities;
+		communities = move(found);
+		communitiesWeighted = useWeights;
+		DBG("Louvain: " << communities.count() << " communities, modularity " << communities.modularity);
+	}
+	return communities;
+}
 
 void Graph::add_node(Node n)
 {
 	nodes.push_back(n);
+	positions.push_back(n.shape.getPosition());
 	adjList.resize(adjList.size() + 1);
+	pinned.push_back(false);
+	localTemp.push_back(0.f);
+	mass.push_back(1.f);
 }
 
 void Graph::add_edge(Edge e)
@@ -234,6 +1164,8 @@ void Graph::add_edge(Edge e)
 	edges.push_back(e);
 	adjList[e[0]].push_back(e[1]);
 	adjList[e[1]].push_back(e[0]);
+	mass[e[0]] += 1.f;
+	mass[e[1]] += 1.f;
 }
 
 const std::vector<Node>& Graph::Nodes() const
@@ -246,6 +1178,33 @@ const vector<Edge>& Graph::Edges() const
 	return edges;
 }
 
+const vector<Vector2f>& Graph::Positions() const
+{
+	return positions;
+}
+
+void Graph::setPositions(const vector<Vector2f>& positions)
+{
+	this->positions = positions;
+	startTemp = DEFAULT_TEMP;
+	clearBundles();
+	rebuildIndex();
+	dirty = true;
+}
+
+const vector<list<int>>& Graph::Adjacency() const
+{
+	return adjList;
+}
+
+float* Graph::PositionBuffer()
+{
+	static_assert(sizeof(Vector2f) == 2 * sizeof(float), "Vector2f must be two packed floats");
+	// caller may write positions through the buffer
+	dirty = true;
+	return reinterpret_cast<float*>(positions.data());
+}
+
 std::ostream& operator<<(std::ostream& os, const Graph& obj) {
 	os << "Graph" << endl << "nodes: ";
 	print_vector(obj.nodes);
@@ -257,7 +1216,22 @@ std::ostream& operator<<(std::ostream& os, const Graph& obj) {
 }
 
 
-Graph Graph::fromGML(string file)
+// Lines parsed between progress reports
+const int PROGRESS_LINES = 4096;
+
+// Publish how far parsing got, throw LoadCancelled if loading was cancelled
+static void reportProgress(LoadProgress* progress, istream& src, size_t nodes, size_t edges)
+{
+	streamoff pos = src.tellg();
+	if (pos >= 0)
+		progress->bytesRead = pos;
+	progress->nodes = nodes;
+	progress->edges = edges;
+	if (progress->cancelled)
+		throw LoadCancelled();
+}
+
+Graph Graph::fromGML(string file, LoadProgress* progress)
 {
 	ifstream src(file);
 	string str;
@@ -272,7 +1246,11 @@ Graph Graph::fromGML(string file)
 	int minus = 0;
 	bool first = true;
 	bool hasWeights = true;
+	bool directed = false;
+	long long lines = 0;
 	while (getline(src, str)) {
+		if (progress && ++lines % PROGRESS_LINES == 0)
+			reportProgress(progress, src, nodes.size(), edges.size());
 		auto trimmed = trim_copy(str);
 		if (trimmed.find("node") != string::npos) {
 			// Parse node
@@ -348,6 +1326,10 @@ Graph Graph::fromGML(string file)
 			// parse rest of edge
 			while (str.find(']') == string::npos && getline(src, str));
 		}
+		else if (trimmed.rfind("directed", 0) == 0) {
+			// 'directed <0|1>'
+			directed = trim_copy(trimmed.substr(8)) == "1";
+		}
 	}
 
 	if (DEBUGGING) {
@@ -357,5 +1339,57 @@ Graph Graph::fromGML(string file)
 		print_vector(edges);
 	}
 
+	Graph G(nodes, edges);
+	G.directed = directed;
+	return G;
+}
+
+Graph Graph::fromEdgeList(string file, LoadProgress* progress)
+{
+	ifstream src(file);
+	if (!src)
+		throw std::runtime_error("Can't open " + file);
+	return fromEdgeList(src, progress);
+}
+
+Graph Graph::fromEdgeList(istream& src, LoadProgress* progress)
+{
+	// Node ids in the file can be arbitrary, they are mapped to 0..n-1 in order of appearance
+	unordered_map<string, int> index;
+	vector<Node> nodes;
+	vector<Edge> edges;
+	auto nodeIndex = [&](const string& id) {
+		auto it = index.find(id);
+		if (it != index.end())
+			return it->second;
+		int i = nodes.size();
+		index[id] = i;
+		nodes.emplace_back(Node::from_id(i, id));
+		return i;
+	};
+
+	string str;
+	long long lines = 0;
+	while (getline(src, str)) {
+		if (progress && ++lines % PROGRESS_LINES == 0)
+			reportProgress(progress, src, nodes.size(), edges.size());
+		trim(str);
+		// skip empty lines and comments
+		if (str.empty() || str[0] == '#' || str[0] == '%')
+			continue;
+
+		// '<source> <target> [weight]'
+		stringstream line(str);
+		string source, target;
+		float w = 1;
+		if (!(line >> source >> target))
+			throw std::invalid_argument("Invalid edge line: " + str);
+		line >> w;
+
+		int s = nodeIndex(source);
+		int t = nodeIndex(target);
+		edges.emplace_back(Edge(s, t, w));
+	}
+
 	return Graph(nodes, edges);
 }
\ No newline at end of file
@@ -2,27 +2,83 @@
 
 #include <vector>
 #include <list>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
 
 #include "Node.hpp"
 #include "Edge.hpp"
+#include "EdgeBundling.hpp"
+#include "SpatialGrid.hpp"
+#include "StressLayout.hpp"
+#include "DensityRenderer.hpp"
+#include "Community.hpp"
+#include "TreeLayout.hpp"
+#include "LayeredLayout.hpp"
+#include "Centrality.hpp"
+#include "LayoutHistory.hpp"
+#include "Overlap.hpp"
+#include "Random.hpp"
+#include "LayoutCache.hpp"
+#include "NodeOrder.hpp"
 #include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/Text.hpp>
 
 using namespace std;
 
 const float DEFAULT_TEMP = CANVAS_HEIGHT / 8;
+// Starting temperature after CommunityLayout() and SpanningTreeLayout()
+const float SEEDED_TEMP = DEFAULT_TEMP / 8;
+// Auto render mode draws the density view from this many nodes on
+const size_t DENSITY_MIN_NODES = 200000;
+
+// What Graph::RestoreLayout() found in the layout cache
+enum CacheUse { CacheMiss, CacheWarmStart, CacheExact };
+// ... or once drawing nodes and edges took longer than this for a few frames
+const float DENSITY_FRAME_MS = 50.f;
+const int DENSITY_SLOW_FRAMES = 3;
+
+enum RenderMode { RenderAuto, RenderNodes, RenderDensity };
+// Order of the nodes in memory: as in the file, reverse Cuthill-McKee by topology or along a Hilbert curve by position
+enum NodeOrdering { OrderFile, OrderRCM, OrderHilbert };
+// Hilbert ordering sorts the nodes again after this many layout steps
+const int HILBERT_REORDER_STEPS = 50;
+// What node size and colour stand for
+enum NodeSizing { SizeByDegree, SizeByBetweenness, SizeByCloseness };
+// Centrality is exact up to this many nodes, estimated from sampled sources above
+const int EXACT_CENTRALITY_NODES = 5000;
+const int CENTRALITY_SAMPLES = 256;
+
+// Progress of a file being parsed, read by the GUI while a background task loads
+struct LoadProgress {
+    long long totalBytes = 0;
+    atomic<long long> bytesRead{ 0 };
+    atomic<int> nodes{ 0 }, edges{ 0 };
+    // set to make the parser stop with LoadCancelled
+    atomic<bool> cancelled{ false };
+};
+
+struct LoadCancelled : std::runtime_error {
+    LoadCancelled() : std::runtime_error("Loading cancelled") {}
+};
 
 class Graph 
 {
-    enum Algorithm { None, Eades, FructhermanReingold, KamadaKawai, YifanHu };
+    enum Algorithm { None, Eades, FructhermanReingold, KamadaKawai, YifanHu, LinLogAlgorithm, ForceAtlas2Algorithm, StressSGDAlgorithm, TreeAlgorithm, RadialTreeAlgorithm, LayeredAlgorithm };
 private:
     vector<list<int>> adjList;
     vector<Node> nodes;
     vector<Edge> edges;
+    // Node positions, kept apart from nodes so layout kernels work on one contiguous array
+    vector<Vector2f> positions;
 
     // Force directed drawing params
     Algorithm algorithm;
     float width, height;
     float temp;
+    // Temperature the algorithm starts from, lower when the initial layout is already close
+    float startTemp = DEFAULT_TEMP;
     float cooling;
     float L;
     float G = 5.f; // gravity
@@ -32,12 +88,110 @@ private:
     float treshold = 0.1f;
     float Gravity = 1.f;
     int iter = 0; // num of iterations
+    bool weighted = false; // some edge weight isn't 1
+    bool useWeights = false; // scale attraction by edge weight, on by default for weighted graphs
+    bool directed = false; // edges go from source to target, read from GML 'directed 1'
+    float weightScale = 1.f; // 1 / average edge weight
+    vector<float> mass; // degree + 1, used by ForceAtlas2
+
+    // ForceAtlas2 adaptive speed state
+    float speed = 1.f;
+    vector<Vector2f> prevForces;
+    // After a rewind, history frame whose forces become prevForces before the next step, -1 if none
+    int forcesFrame = -1;
+
+    // Scratch buffers reused by every step, so steady stepping doesn't allocate
+    vector<Vector2f> forces;
+    vector<float> swing;
+
+    // Stress layout state
+    StressLayout stressLayout;
+
+    // Layout after every step, for stepping back
+    bool recordHistory = false;
+    LayoutHistory history;
+    // Frame shown, the last one unless rewound, stepping continues from it
+    int historyFrame = -1;
+
+    // Louvain communities, computed on first use
+    Communities communities;
+    bool communitiesWeighted = false;
 
     // Parameters used in drawing
     int maxDegree;
     float maxWeight;
     float nodeMin = DEFAULT_RADIUS, nodeMax = DEFAULT_RADIUS;
     bool showLabels = false;
+    bool colorCommunities = false;
+    NodeSizing nodeSizing = SizeByDegree;
+    // Node size by centrality, scaled to [0, 1]
+    vector<float> importance;
+
+    // Push overlapping nodes apart once the layout has converged
+    bool noOverlaps = false;
+    // Layout before and after the last overlap removal, new node sizes start again from the layout
+    vector<Vector2f> unadjusted, adjusted;
+
+    // Centrality computed in the background, 'centralityJob' is set while it runs
+    struct CentralityJob {
+        atomic<bool> ready{ false };
+        Centrality result;
+        // Node::id of every node when the job started, the graph may be reordered meanwhile
+        vector<int> ids;
+    };
+    shared_ptr<CentralityJob> centralityJob;
+    Centrality centrality;
+
+    // Edge bundling, runs on the thread pool once the layout has converged, 'bundlingJob' is set while it runs
+    struct BundlingJob {
+        atomic<bool> ready{ false };
+        EdgeBundler result;
+    };
+    bool bundleEdges = false;
+    EdgeBundler bundler;
+    shared_ptr<BundlingJob> bundlingJob;
+    VertexArray bundledEdges;
+
+    // Density view for large graphs
+    RenderMode renderMode = RenderAuto;
+    DensityTransfer densityTransfer = EqualizeTransfer;
+    DensityRenderer density;
+    // Consecutive slow frames of the node and edge view, switches auto mode to density
+    int slowFrames = 0;
+    bool densityLatched = false;
+    // Something drawn has changed since the last draw()
+    bool dirty = true;
+
+    // Per frame geometry, rebuilt in place every draw()
+    VertexArray edgeVertices;
+    vector<Vector2f> centers;
+    // Label texts, built once per font
+    vector<Text> labelTexts;
+    const Font* labelFont = nullptr;
+
+    // Heap allocations made by the last layout step and the last draw()
+    unsigned long long stepAllocations = 0;
+    unsigned long long frameAllocations = 0;
+
+    // Interaction
+    // Spatial index over node positions, kept current after every step
+    SpatialGrid nodeIndex;
+    // Pinned nodes are not moved by the layout
+    vector<bool> pinned;
+    // Extra temperature of nodes reheated by dragging, cools down like temp
+    vector<float> localTemp;
+    // A converged layout is adapting to a dragged node
+    bool settling = false;
+    int hovered = -1, selected = -1;
+    // Seed of the random initial layouts and of the stress layout
+    unsigned seed = 0;
+
+    // Nodes are renumbered for memory locality, Node::id keeps the index in the file
+    NodeOrdering nodeOrdering = OrderFile;
+    // Steps since the last Hilbert reordering
+    int reorderSteps = 0;
+    // Positions by Node::id, history frames are kept in file order so they survive reordering
+    vector<Vector2f> byId;
 public:
     Graph() = default;
     Graph(vector<Node>& nodes, vector<Edge>& edges);
@@ -48,11 +202,52 @@ public:
     void add_edge(Edge e);
     const vector<Node>& Nodes() const;
     const vector<Edge>& Edges() const;
+    const vector<Vector2f>& Positions() const;
+    void setPositions(const vector<Vector2f>& positions);
+    const vector<list<int>>& Adjacency() const;
+    // Node positions as interleaved x, y floats, written in place by every step
+    float* PositionBuffer();
 
+    // Random layouts depend only on the seed, not on the number of threads
+    void setSeed(unsigned seed);
+    unsigned Seed() const;
     // Place nodes randomly in a rectangle area defined by pos and L
     void RandomLayout(Vector2f pos, float L);
     // Place nodes randomly on circle line defined by pos and R
     void RandomCircularLayout(Vector2f pos, float R);
+    // Place every community in its own region of the circle defined by pos and R
+    void CommunityLayout(Vector2f pos, float R);
+    // Radial layout of a BFS spanning tree in the circle defined by pos and R, a seed for graphs that are mostly a tree
+    void SpanningTreeLayout(Vector2f pos, float R);
+    // Temperature the next run starts from, the initial layouts above set it, call it after them to override
+    void setStartTemp(float temp);
+    // True if the graph has no cycles
+    bool IsForest() const;
+    // True if edge direction matters
+    bool IsDirected() const;
+
+    // Renumber the nodes for cache friendly layout steps. RCM is applied once, Hilbert now and again every
+    // HILBERT_REORDER_STEPS steps. Labels and ids stay with their nodes, Positions() and the other per node data
+    // follow the new order, File order goes back to the order of the file.
+    void setNodeOrdering(NodeOrdering ordering);
+    NodeOrdering Ordering() const;
+
+    // Hash of the graph, its edge weights and the current algorithm with its parameters
+    uint64_t LayoutKey() const;
+    // Call after choosing the algorithm. With a cached layout for LayoutKey() the graph is shown converged,
+    // otherwise the layout of the most similar cached graph is the starting layout and 'similarity' says how similar it is
+    CacheUse RestoreLayout(LayoutCache& cache, float* similarity = nullptr);
+    // Store the converged layout, before overlap removal
+    void StoreLayout(LayoutCache& cache) const;
+
+    // Louvain communities of the graph, weighted if edge weights are used.
+    // Nothing is stored when 'cancelled' stops the detection
+    const Communities& DetectCommunities(function<bool()> cancelled = nullptr);
+
+    // Start computing betweenness and closeness centrality on the thread pool
+    void ComputeCentrality();
+    // Pick up results of background work, returns true while some is still running
+    bool PollBackground();
 
     /* Force directed graph drawing operations
     * 
@@ -64,27 +259,131 @@ public:
     // l - ideal spring length
     // cool - cooling rate
     void FruchtermanReingold(FruchtermanParams);
+    // LinLog, logarithmic attraction
+    void LinLog(FruchtermanParams);
+    // ForceAtlas2, degree-weighted repulsion and adaptive speed
+    void ForceAtlas2(FruchtermanParams);
+    // Stress minimization by SGD, one epoch per Update()
+    void StressSGD(FruchtermanParams);
+    // Tree layout (Buchheim-Walker) of the spanning forest, computed in a single Update()
+    // radial - levels on concentric circles instead of rows
+    void Tree(FruchtermanParams, bool radial);
+    // Layered (Sugiyama) layout with edges pointing down, computed in a single Update()
+    void Layered(FruchtermanParams);
+    // Change parameters of the selected algorithm and restart cooling
+    void setParams(FruchtermanParams);
+    // True if the edges carry weights other than 1
+    bool Weighted() const;
+    // Set whether edge weights scale the attractive forces
+    void setUseWeights(bool useWeights);
     // Run 1 iteraton, return !done
     bool Update();
-    // Reset the 'done' flag
+    // Reset the 'done' flag and unpin all nodes
     void Reset();
+    // Record the layout after every step
+    void setRecordHistory(bool recordHistory);
+    // Show recorded frame 'frame', the next step continues from it and drops the later frames
+    void Rewind(int frame);
+    // Oldest and newest recorded frame and the frame shown, last < first when nothing is recorded
+    int HistoryFirst() const;
+    int HistoryLast() const;
+    int HistoryFrame() const;
 
     // Parse contents of GML file and create a Graph
-    static Graph fromGML(string file);
+    // With 'progress' the parser reports how far it got and throws LoadCancelled once it is cancelled
+    static Graph fromGML(string file, LoadProgress* progress = nullptr);
+    // Parse an edge list, one '<source> <target> [weight]' per line, '#' and '%' start comments
+    static Graph fromEdgeList(string file, LoadProgress* progress = nullptr);
+    static Graph fromEdgeList(istream& src, LoadProgress* progress = nullptr);
 
     /* Drawing the graph
     *
     * Functions for configuring and modyfing how the graph will be drawn
     */
     // Draw the graph
-    void draw(tgui::CanvasSFML::Ptr& target, sf::Font font);
+    void draw(tgui::CanvasSFML::Ptr& target, const sf::Font& font);
     // Set drawing parameters
     void setNodeDimensions(float nodeMin, float nodeMax);
     // Set whether to show labels
     void setShowLabels(bool showLabels);
+    // Set what node size and colour stand for, centralities are shown once computed
+    void setNodeSizing(NodeSizing nodeSizing);
+    // Remove node overlaps after convergence, and again whenever node sizes change
+    void setRemoveOverlaps(bool removeOverlaps);
+    // Set whether nodes are coloured by their community
+    void setColorCommunities(bool colorCommunities);
+    // Set whether to bundle edges after the layout converges
+    void setBundleEdges(bool bundleEdges);
+    // Choose between drawing every node and edge or the aggregated density view
+    void setRenderMode(RenderMode renderMode, DensityTransfer transfer);
+    // True if the density view is drawn instead of nodes and edges
+    bool DensityView() const;
+    // True if the picture changed since the last draw(), the canvas only needs redrawing then
+    bool Dirty() const;
+    // Heap allocations made by the last layout step (history recording excluded) and by the last draw()
+    unsigned long long StepAllocations() const;
+    unsigned long long FrameAllocations() const;
+
+    /* Interaction
+    *
+    * Nodes can be hovered, selected and dragged with the mouse.
+    * Dragged nodes stay pinned until Reset() and their neighbourhood is reheated so the layout adapts around them.
+    */
+    // Index of the node drawn under point p (canvas coordinates), -1 if there is none
+    int pick(Vector2f p) const;
+    void setHovered(int i);
+    void setSelected(int i);
+    // Selected node, -1 if none. Reordering renumbers it, so hold on to it here rather than keep its index
+    int Selected() const;
+    // Move node i so it is drawn centered at p and pin it there
+    void dragNode(int i, Vector2f p);
+    // Let the layout move node i again
+    void unpin(int i);
+    // True while a converged layout adapts to a dragged node
+    bool Settling() const;
 private:
     // Implementation of force-directed drawing algorithms, returns true if equilibrum is reached
     bool fructhermanReingoldStep();
+    // Single step of a force-directed algorithm, Model is one of the policies in ForceModel.hpp
+    template<typename Model, bool Weighted>
+    bool forceDirectedStep();
+    // Sum the forces on every node into 'forces', before they are limited by temperature
+    template<typename Model, bool Weighted>
+    void computeForces();
+    // Recompute prevForces from history frame forcesFrame, so ForceAtlas2 continues a rewound run
+    void restorePrevForces();
+    // Scale forces by ForceAtlas2 adaptive speed
+    void adaptSpeed(vector<Vector2f>& forces);
+    // Recompute 'importance' from the centrality selected by nodeSizing
+    void updateImportance();
+    // Position, size and highlight of the shape of node i
+    void updateShape(int i);
+    // Radius node i is drawn with
+    float nodeRadius(int i) const;
+    // Remove overlaps of the drawn circles from the current positions
+    void separateNodes();
+    // Node sizes changed, separate a converged layout again
+    void resizeNodes();
+    // Build the stress terms for the current L
+    void initStress();
+    // Clamp node i to the layout area, shared by the layout steps and dragging
+    void keepInside(int i);
+    // Bundle edges of the current layout in the background, PollBackground() picks up the result
+    void startBundling();
+    // Drop bundles and a bundling job still running, nodes have moved
+    void clearBundles();
+    // Rebuild the spatial index over node positions
+    void rebuildIndex();
+    // Append the current layout to the history
+    void recordFrame();
+    // Restore positions from history frame 'frame', returns its state
+    LayoutHistory::State restoreFrame(int frame);
+    // Raise local temperature of nodes close to node i
+    void reheat(int i);
+    // Move node order[k] to index k in every per node array
+    void permuteNodes(const vector<int>& order);
+    // Signature of the edge set for finding similar cached graphs
+    LayoutCache::Signature cacheSignature() const;
 };
 
 
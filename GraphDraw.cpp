@@ -0,0 +1,136 @@
+#include <vector>
+#include <chrono>
+
+#include "Graph.hpp"
+#include "Util.hpp"
+#include <SFML/Graphics/Text.hpp>
+#include "Line.hpp"
+#include "Allocations.hpp"
+
+const float thickness = 1.5f;
+const Color NODE_COLOR = Color::White;
+const Color SELECTED_COLOR = Color::Cyan;
+const Color HOVER_COLOR = Color::Blue;
+const Color PINNED_COLOR = Color::Red;
+const float OUTLINE = 2.f;
+
+// Colour of a node by its centrality, from NODE_COLOR for the least to IMPORTANT_COLOR for the most central
+const Color IMPORTANT_COLOR = Color(255, 120, 0);
+
+static Color importanceColor(float v) {
+	auto mix = [v](Uint8 a, Uint8 b) { return (Uint8)(a + (b - a) * v); };
+	return Color(mix(NODE_COLOR.r, IMPORTANT_COLOR.r), mix(NODE_COLOR.g, IMPORTANT_COLOR.g), mix(NODE_COLOR.b, IMPORTANT_COLOR.b));
+}
+
+// Distinct colour for every community, hues are spread by the golden angle
+static Color communityColor(int c) {
+	float h = fmod(c * 0.618034f, 1.f) * 6.f;
+	float x = 1.f - abs(fmod(h, 2.f) - 1.f);
+	float r = 0.f, g = 0.f, b = 0.f;
+	switch ((int)h) {
+	case 0: r = 1; g = x; break;
+	case 1: r = x; g = 1; break;
+	case 2: g = 1; b = x; break;
+	case 3: g = x; b = 1; break;
+	case 4: r = x; b = 1; break;
+	default: r = 1; b = x;
+	}
+	// pastel, so labels and highlights stay readable
+	auto channel = [](float v) { return (Uint8)(80 + 175 * v); };
+	return Color(channel(r), channel(g), channel(b));
+}
+
+void Graph::draw(tgui::CanvasSFML::Ptr &target, const sf::Font& font)
+{
+	dirty = false;
+	unsigned long long allocations = allocationCount();
+	if (DensityView()) {
+		density.update(target->getRenderTexture().getSize(), positions, edges, densityTransfer);
+		target->draw(density);
+		// Keep the hovered and selected nodes visible on top
+		for (int i : { selected, hovered }) {
+			if (i != -1) {
+				updateShape(i);
+				target->draw(nodes[i].shape);
+			}
+		}
+		frameAllocations = allocationCount() - allocations;
+		return;
+	}
+
+	auto frameStart = chrono::steady_clock::now();
+
+	for (int i = 0; i < nodes.size(); ++i)
+		updateShape(i);
+
+	if (bundler.ready()) {
+		centers.resize(nodes.size());
+		for (int i = 0; i < nodes.size(); ++i)
+			centers[i] = nodes[i].shape.getOrigin();
+		bundledEdges.clear();
+		bundler.buildVertices(bundledEdges, centers, thickness, LINE_COLOR);
+		target->draw(bundledEdges);
+	}
+	else {
+		// All edges in one vertex array, its storage is kept between frames
+		edgeVertices.setPrimitiveType(Quads);
+		edgeVertices.clear();
+		for (const Edge& e : edges) {
+			const CircleShape& node1 = nodes[e[0]].shape;
+			const CircleShape& node2 = nodes[e[1]].shape;
+			appendLine(edgeVertices, node1.getPosition() + node1.getOrigin(), node2.getPosition() + node2.getOrigin(), thickness);
+		}
+		target->draw(edgeVertices);
+	}
+
+	// Label geometry only depends on the text and the font, build it once
+	if (showLabels && (labelFont != &font || labelTexts.size() != nodes.size())) {
+		labelTexts.clear();
+		for (const Node& node : nodes) {
+			sf::Text label{ node.label, font };
+			label.setFillColor(sf::Color::Red);
+			label.setCharacterSize(18);
+			FloatRect numRect = label.getGlobalBounds();
+			Vector2f numRectCenter(numRect.width / 2.0f + numRect.left, numRect.height / 2.0f + numRect.top);
+			label.setOrigin(numRectCenter);
+			labelTexts.push_back(label);
+		}
+		labelFont = &font;
+	}
+
+	for (int i = 0; i < nodes.size(); ++i) {
+		target->draw(nodes[i].shape);
+
+		if (showLabels) {
+			labelTexts[i].setPosition(positions[i].x, positions[i].y);
+			target->draw(labelTexts[i]);
+		}
+
+	}
+
+	// Too slow to draw every node, auto mode falls back to the density view
+	float ms = chrono::duration<float, milli>(chrono::steady_clock::now() - frameStart).count();
+	slowFrames = ms > DENSITY_FRAME_MS ? slowFrames + 1 : 0;
+	if (renderMode == RenderAuto && slowFrames >= DENSITY_SLOW_FRAMES) {
+		densityLatched = true;
+		dirty = true;
+	}
+	frameAllocations = allocationCount() - allocations;
+}
+
+void Graph::updateShape(int i)
+{
+	nodes[i].shape.setPosition(positions[i]);
+	float scaledR = nodeRadius(i);
+	nodes[i].shape.setOrigin(scaledR / 2, scaledR / 2);
+	nodes[i].shape.setRadius(scaledR);
+
+	Color fill = NODE_COLOR;
+	if (colorCommunities && i < communities.of.size())
+		fill = communityColor(communities.of[i]);
+	else if (!importance.empty())
+		fill = importanceColor(importance[i]);
+	nodes[i].shape.setFillColor(i == selected ? SELECTED_COLOR : fill);
+	nodes[i].shape.setOutlineColor(i == hovered ? HOVER_COLOR : PINNED_COLOR);
+	nodes[i].shape.setOutlineThickness(i == hovered || pinned[i] ? OUTLINE : 0.f);
+}
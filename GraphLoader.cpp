@@ -0,0 +1,78 @@
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+
+#include "GraphLoader.hpp"
+#include "ThreadPool.hpp"
+
+namespace fs = std::filesystem;
+
+GraphLoader::GraphLoader()
+{
+	// Loads use the pool (Louvain, layouts), creating it first makes it outlive the loader
+	ThreadPool::global();
+}
+
+GraphLoader::~GraphLoader()
+{
+	cancel();
+	if (worker.joinable())
+		worker.join();
+}
+
+void GraphLoader::start(const string& file, function<void(Graph&, const LoadProgress&)> prepare)
+{
+	cancel();
+	// The previous load stops at its next progress report or stage of 'prepare'
+	if (worker.joinable())
+		worker.join();
+	job = make_shared<Job>();
+	error_code ec;
+	auto bytes = fs::file_size(file, ec);
+	job->progress.totalBytes = ec ? 0 : (long long)bytes;
+
+	// Loading gets its own thread, on the pool it could queue behind long background work (centrality).
+	// The thread keeps its own reference, a cancelled job lives until the thread notices
+	worker = thread([job = job, file, prepare]() {
+		try {
+			string ext = fs::path(file).extension().string();
+			transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			Graph G = ext == ".gml" ? Graph::fromGML(file, &job->progress) : Graph::fromEdgeList(file, &job->progress);
+			if (G.Nodes().empty())
+				throw runtime_error("No nodes in " + file);
+			job->progress.bytesRead = job->progress.totalBytes;
+			job->progress.nodes = G.Nodes().size();
+			job->progress.edges = G.Edges().size();
+			if (prepare && !job->progress.cancelled)
+				prepare(G, job->progress);
+			if (job->progress.cancelled)
+				throw LoadCancelled();
+			job->graph = make_unique<Graph>(move(G));
+		}
+		catch (const exception& e) {
+			job->error = e.what();
+		}
+		job->done = true;
+	});
+}
+
+void GraphLoader::cancel()
+{
+	if (job) {
+		job->progress.cancelled = true;
+		job = nullptr;
+	}
+}
+
+bool GraphLoader::poll(Graph& G, string& error)
+{
+	if (!job || !job->done)
+		return false;
+
+	worker.join();
+	if (job->graph)
+		G = move(*job->graph);
+	error = job->error;
+	job = nullptr;
+	return true;
+}
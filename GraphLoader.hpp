@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <thread>
+
+#include "Graph.hpp"
+
+using namespace std;
+
+/* Loads a graph on a background thread
+*
+* The graph being shown keeps rendering while a file is parsed, poll() hands over the new graph
+* once it is complete so the caller can swap it in at once.
+* Cancelling stops the parser at its next progress report, 'prepare' is expected to check progress.cancelled
+* between its stages. The thread is joined by the next start() and by the destructor, so no load outlives the loader.
+*/
+class GraphLoader
+{
+public:
+	GraphLoader();
+	~GraphLoader();
+
+	// Start loading a GML or edge list file (by extension), a load still running is cancelled.
+	// 'prepare' runs on the loaded graph in the background as well, for setup too slow for the GUI thread
+	void start(const string& file, function<void(Graph&, const LoadProgress&)> prepare = nullptr);
+	void cancel();
+	bool loading() const { return job != nullptr; }
+	// Progress of the running load, only valid while loading()
+	const LoadProgress& progress() const { return job->progress; }
+
+	// Returns true once the running load has finished. The graph is moved to 'G' unless it failed,
+	// then 'error' says why
+	bool poll(Graph& G, string& error);
+private:
+	struct Job {
+		LoadProgress progress;
+		atomic<bool> done{ false };
+		unique_ptr<Graph> graph;
+		string error;
+	};
+	shared_ptr<Job> job;
+	thread worker;
+};
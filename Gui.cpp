@@ -1,12 +1,37 @@
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <cmath>
 
 #include "Gui.hpp"
 #include "Util.hpp"
 #include "Graph.hpp"
+#include "GraphLoader.hpp"
+
+// The selected node is being dragged with the mouse
+static bool dragging = false;
+// The history slider is being moved to follow the graph, not by the user
+static bool syncingHistory = false;
+// The user picked an algorithm, loading a graph keeps it instead of picking one for the graph
+static bool algorithmChosen = false;
+// The algorithm combo is being set by a load, not by the user
+static bool suggestingAlgorithm = false;
+// Graph file being loaded in the background, created on first use, after the thread pool is configured
+static GraphLoader& loader() {
+	static GraphLoader instance;
+	return instance;
+}
+// Converged layouts of graphs opened before
+static LayoutCache layoutCache("layout_cache");
 
 void addMenu(tgui::Gui& gui, Graph& G);
+// Configure G with the algorithm selected in the combo box
+void applyAlgorithm(tgui::Gui& gui, Graph& G);
+// Configure how G is drawn from the render combo box
+void applyRenderMode(tgui::Gui& gui, Graph& G);
+// Initial layout selected in the combo box: random, seeded by communities or by a spanning tree
+void initialLayout(tgui::Gui& gui, Graph& G);
+void initialLayout(int choice, Graph& G);
 void openFileDialog(tgui::Gui& gui, Graph& G);
 // Setup a control button (play/pause etc) in the left panel 
 void setupControlButton(tgui::BitmapButton::Ptr& btn);
@@ -40,15 +65,41 @@ static void openFileDialog(tgui::Gui& gui, Graph& G) {
 		else {
 			auto& path = paths[0];
 			if (path.getFilename().ends_with(".gml")) {
-				G = Graph::fromGML(path.asString().toStdString());
-				G.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+				// Settings are read here, the loading thread must not touch the widgets
 				auto nodeSizer = gui.get<tgui::RangeSlider>("nodeSizer");
 				float nodeMin = nodeSizer->getSelectionStart();
 				float nodeMax = nodeSizer->getSelectionEnd();
-				G.setNodeDimensions(nodeMin, nodeMax);
-				G.FruchtermanReingold(params);
-				DBG(G);
-				GUI::updateWidgetsPause(gui);
+				bool bundleEdges = gui.get<tgui::CheckBox>("bundleEdges")->isChecked();
+				bool removeOverlaps = gui.get<tgui::CheckBox>("removeOverlaps")->isChecked();
+				bool useWeights = gui.get<tgui::CheckBox>("useWeights")->isChecked();
+				bool colorCommunities = gui.get<tgui::CheckBox>("colorCommunities")->isChecked();
+				NodeSizing sizing = (NodeSizing)gui.get<tgui::ComboBox>("sizeSelect")->getSelectedItemIndex();
+				int init = gui.get<tgui::ComboBox>("initSelect")->getSelectedItemIndex();
+				unsigned seed = gui.get<tgui::EditBox>("seed")->getText().toUInt(G.Seed());
+				NodeOrdering ordering = (NodeOrdering)gui.get<tgui::ComboBox>("orderSelect")->getSelectedItemIndex();
+
+				// Community detection and the initial layout are slow on big graphs, they run with the parsing
+				loader().start(path.asString().toStdString(), [=](Graph& loaded, const LoadProgress& progress) {
+					loaded.setRecordHistory(true);
+					loaded.setNodeDimensions(nodeMin, nodeMax);
+					loaded.setBundleEdges(bundleEdges);
+					loaded.setRemoveOverlaps(removeOverlaps);
+					loaded.setUseWeights(useWeights && loaded.Weighted());
+					// Louvain is the slow part, it stops early when loading is cancelled, and so does the rest
+					auto cancelled = [&progress]() { return progress.cancelled.load(); };
+					if (init == 1 || colorCommunities)
+						loaded.DetectCommunities(cancelled);
+					if (cancelled())
+						return;
+					loaded.setColorCommunities(colorCommunities);
+					loaded.setNodeSizing(sizing);
+					loaded.setSeed(seed);
+					initialLayout(init, loaded);
+					// After the initial layout like batch mode does, Hilbert order sorts by position
+					loaded.setNodeOrdering(ordering);
+				});
+				gui.get<tgui::ProgressBar>("loadProgress")->setVisible(true);
+				gui.get<tgui::Button>("cancelLoad")->setVisible(true);
 			}
 		}
 		});
@@ -94,6 +145,65 @@ static void addMenu(tgui::Gui& gui, Graph& G) {
 	gui.add(menu);
 }
 
+static void applyAlgorithm(tgui::Gui& gui, Graph& G) {
+	switch (gui.get<tgui::ComboBox>("algoSelect")->getSelectedItemIndex()) {
+	case 1:
+		G.LinLog(params);
+		break;
+	case 2:
+		G.ForceAtlas2(params);
+		break;
+	case 3:
+		G.StressSGD(params);
+		break;
+	case 4:
+		G.Tree(params, false);
+		break;
+	case 5:
+		G.Tree(params, true);
+		break;
+	case 6:
+		G.Layered(params);
+		break;
+	default:
+		G.FruchtermanReingold(params);
+	}
+}
+
+static void applyRenderMode(tgui::Gui& gui, Graph& G) {
+	switch (gui.get<tgui::ComboBox>("renderSelect")->getSelectedItemIndex()) {
+	case 1:
+		G.setRenderMode(RenderNodes, EqualizeTransfer);
+		break;
+	case 2:
+		G.setRenderMode(RenderDensity, LogTransfer);
+		break;
+	case 3:
+		G.setRenderMode(RenderDensity, EqualizeTransfer);
+		break;
+	default:
+		G.setRenderMode(RenderAuto, EqualizeTransfer);
+	}
+}
+
+static void initialLayout(tgui::Gui& gui, Graph& G) {
+	initialLayout(gui.get<tgui::ComboBox>("initSelect")->getSelectedItemIndex(), G);
+}
+
+static void initialLayout(int choice, Graph& G) {
+	Vector2f center(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f);
+	switch (choice) {
+	case 1:
+		G.CommunityLayout(center, CANVAS_HEIGHT * 0.40);
+		break;
+	case 2:
+		G.SpanningTreeLayout(center, CANVAS_HEIGHT * 0.40);
+		break;
+	default:
+		G.RandomCircularLayout(center, CANVAS_HEIGHT * 0.40);
+	}
+}
+
 static void setupControlButton(tgui::BitmapButton::Ptr& btn) {
 	btn->setSize({ LEFT_MENU / 4, LEFT_MENU / 4 });
 	btn->setImageScaling(1.f);
@@ -138,6 +248,126 @@ void  GUI::updateWidgetsReset(tgui::Gui& gui) {
 	gui.get<tgui::BitmapButton>("nextBtn")->setVisible(true);
 }
 
+bool GUI::pollLoading(tgui::Gui& gui, Graph& G)
+{
+	if (!loader().loading())
+		return false;
+
+	string error;
+	if (!loader().poll(G, error)) {
+		const LoadProgress& progress = loader().progress();
+		auto bar = gui.get<tgui::ProgressBar>("loadProgress");
+		bar->setValue(progress.totalBytes > 0 ? unsigned(progress.bytesRead * 1000 / progress.totalBytes) : 0);
+		bar->setText(to_string(progress.bytesRead / (1 << 20)) + " MB, " + to_string(progress.nodes) + " nodes, "
+			+ to_string(progress.edges) + " edges");
+		return true;
+	}
+
+	gui.get<tgui::ProgressBar>("loadProgress")->setVisible(false);
+	gui.get<tgui::Button>("cancelLoad")->setVisible(false);
+	if (!error.empty()) {
+		cout << "Failed to load graph: " << error << endl;
+		return false;
+	}
+
+	// The new graph is in place, finish the setup that needs the widgets
+	dragging = false;
+	RUNNING = false;
+	G.ComputeCentrality();
+	params = calcFruchtParams(G.Nodes().size(), gui.get<tgui::Slider>("kSlider")->getValue());
+	// Directed graphs suit the layered layout and trees the exact tree layout instead of a force simulation,
+	// other graphs a force simulation. This only changes the default, a choice of the user is kept.
+	auto algoSelect = gui.get<tgui::ComboBox>("algoSelect");
+	int selected = algoSelect->getSelectedItemIndex();
+	bool treeSelected = selected == 4 || selected == 5;
+	int suggested = selected;
+	if (G.IsDirected())
+		suggested = 6;
+	else if (G.IsForest() && !treeSelected)
+		suggested = 4;
+	else if (!G.IsForest() && selected >= 4)
+		suggested = 0;
+	if (suggested != selected && algorithmChosen)
+		cout << "Tip: " << algoSelect->getItems()[suggested].toStdString() << " usually suits this graph better" << endl;
+	else if (suggested != selected) {
+		suggestingAlgorithm = true;
+		algoSelect->setSelectedItemByIndex(suggested);
+		suggestingAlgorithm = false;
+	}
+	applyAlgorithm(gui, G);
+	applyRenderMode(gui, G);
+	DBG(G);
+	float similarity;
+	CacheUse cached = G.RestoreLayout(layoutCache, &similarity);
+	if (cached == CacheExact) {
+		cout << "Layout restored from the cache" << endl;
+		GUI::updateWidgetsDone(gui);
+		return false;
+	}
+	if (cached == CacheWarmStart)
+		cout << "Starting from the cached layout of a similar graph (" << (int)(similarity * 100) << "% of edges shared)" << endl;
+	GUI::updateWidgetsPause(gui);
+	return false;
+}
+
+void GUI::cacheLayout(const Graph& G)
+{
+	G.StoreLayout(layoutCache);
+}
+
+void GUI::updateHistory(tgui::Gui& gui, const Graph& G)
+{
+	auto historySlider = gui.get<tgui::Slider>("historySlider");
+	int first = G.HistoryFirst(), last = max(G.HistoryLast(), first);
+	int frame = max(G.HistoryFrame(), first);
+	if (historySlider->getMinimum() == first && historySlider->getMaximum() == last && historySlider->getValue() == frame)
+		return;
+	syncingHistory = true;
+	historySlider->setMaximum(last);
+	historySlider->setMinimum(first);
+	historySlider->setValue(frame);
+	syncingHistory = false;
+}
+
+void GUI::handleCanvasEvent(const sf::Event& event, Graph& G)
+{
+	auto toCanvas = [](int x, int y) {
+		return Vector2f(x - CANVAS_OFFSET.x, y - CANVAS_OFFSET.y);
+	};
+	auto inCanvas = [](Vector2f p) {
+		return p.x >= 0 && p.y >= 0 && p.x < CANVAS_WIDTH && p.y < CANVAS_HEIGHT;
+	};
+
+	if (event.type == Event::MouseMoved) {
+		Vector2f p = toCanvas(event.mouseMove.x, event.mouseMove.y);
+		if (dragging && G.Selected() != -1)
+			G.dragNode(G.Selected(), p);
+		else
+			G.setHovered(inCanvas(p) ? G.pick(p) : -1);
+	}
+	else if (event.type == Event::MouseButtonPressed) {
+		Vector2f p = toCanvas(event.mouseButton.x, event.mouseButton.y);
+		if (!inCanvas(p))
+			return;
+
+		int i = G.pick(p);
+		if (event.mouseButton.button == Mouse::Left) {
+			// Left button selects and drags, releasing leaves the node pinned
+			G.setSelected(i);
+			dragging = true;
+			if (i != -1)
+				G.dragNode(i, p);
+		}
+		else if (event.mouseButton.button == Mouse::Right && i != -1) {
+			// Right button unpins
+			G.unpin(i);
+		}
+	}
+	else if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
+		dragging = false;
+	}
+}
+
 void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 	auto algoSelectLabel = tgui::Label::create("Select algorithm:");
 	algoSelectLabel->setPosition(LEFT_MENU / 8.f, 80.f);
@@ -148,10 +378,18 @@ void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 	algoSelect->setTextSize(12);
 	algoSelect->setPosition(algoPos);
 	algoSelect->addItem("FruchtermanReingold");
+	algoSelect->addItem("LinLog");
+	algoSelect->addItem("ForceAtlas2");
+	algoSelect->addItem("Stress (SGD)");
+	algoSelect->addItem("Tree");
+	algoSelect->addItem("Radial tree");
+	algoSelect->addItem("Layered");
 	algoSelect->setSelectedItemByIndex(0);
 
-	algoSelect->onItemSelect([](const tgui::String& item) {
-		// Algorithm selected
+	algoSelect->onItemSelect([&gui, &G](const tgui::String& item) {
+		if (!suggestingAlgorithm)
+			algorithmChosen = true;
+		applyAlgorithm(gui, G);
 		});
 
 	auto playPos = tgui::Layout2d(LEFT_MENU / 2.f - LEFT_MENU / 8.f, 150.f);
@@ -164,7 +402,7 @@ void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 
 	auto prevBtn = tgui::BitmapButton::create();
 	prevBtn->setImage("icons/previous.png");
-	prevBtn->setPosition(LEFT_MENU / 2, 200.f);
+	prevBtn->setPosition(LEFT_MENU / 2.f - 3 * LEFT_MENU / 8.f, 150.f);
 	setupControlButton(prevBtn);
 
 	auto nextBtn = tgui::BitmapButton::create();
@@ -194,13 +432,38 @@ void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 		G.Update();
 		});
 
+	prevBtn->onPress([&G, &gui]() {
+		RUNNING = false;
+		updateWidgetsPause(gui);
+		G.Rewind(G.HistoryFrame() - 1);
+		});
+
+	// Scrubber over the recorded iterations
+	auto historySlider = tgui::Slider::create();
+	historySlider->setMinimum(0);
+	historySlider->setMaximum(0);
+	historySlider->setStep(1);
+	historySlider->setSize({ LEFT_MENU * 3 / 4.f, 8.f });
+	historySlider->setPosition(LEFT_MENU / 8, playPos.y + LEFT_MENU / 4 + 10.f);
+
+	historySlider->onValueChange([&G, &gui](float value) {
+		if (syncingHistory || (int)value == G.HistoryFrame())
+			return;
+		RUNNING = false;
+		updateWidgetsPause(gui);
+		G.Rewind((int)value);
+		});
+
 	pauseBtn->onPress([&G, &gui]() {
 		RUNNING = false;
 		updateWidgetsPause(gui);
 		});
 
+	// Every restart is a new random layout, its seed is shown so it can be reproduced
 	resetBtn->onPress([&gui, &G]() {
-		G.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+		G.setSeed(randomSeed());
+		gui.get<tgui::EditBox>("seed")->setText(to_string(G.Seed()));
+		initialLayout(gui, G);
 		G.Reset();
 		updateWidgetsReset(gui);
 		});
@@ -208,9 +471,9 @@ void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 	resetBtn->setVisible(false);
 
 	auto slider = tgui::Slider::create();
-	slider->setMinimum(1);
+	slider->setMinimum(0);
 	slider->setMaximum(100);
-	slider->setStep(10);
+	slider->setStep(5);
 	slider->setValue(100);
 	slider->setSize({ LEFT_MENU*3/4.f, 10.f });
 	slider->setPosition(LEFT_MENU/8, playPos.y + 100.f);
@@ -222,13 +485,12 @@ void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 	sliderLabel->setPosition({ LEFT_MENU/2-24.f, slider->getPosition().y - 25.f });
 
 	slider->onValueChange([](float value) {
-		cout << "Framerate changed to " << value << endl;
-		if (value == 100) {
-			FRAMERATE = 0;
-		}
-		else {
-			FRAMERATE = value;
-		}
+		// Logarithmic, 1 to about 6000 iterations per second, the right end runs as fast as the frame budget allows
+		ITERATIONS_PER_SECOND = value == 100 ? 0 : round(pow(10.f, value / 25));
+		if (ITERATIONS_PER_SECOND == 0)
+			cout << "Speed changed to unlimited" << endl;
+		else
+			cout << "Speed changed to " << ITERATIONS_PER_SECOND << " iterations/s" << endl;
 		});
 
 	auto kSlider = tgui::Slider::create();
@@ -247,7 +509,7 @@ void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 
 	kSlider->onValueChange([&G](float value) {
 		params = calcFruchtParams(G.Nodes().size(), value);
-		G.FruchtermanReingold(params);
+		G.setParams(params);
 	});
 
 	auto nodeSizerLabel = tgui::Label::create("Node sizes (min, max)");
@@ -266,20 +528,146 @@ void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 		G.setNodeDimensions(start, end);
 	});
 
+	auto sizeSelect = tgui::ComboBox::create();
+	sizeSelect->setTextSize(12);
+	sizeSelect->setPosition({ LEFT_MENU / 8, nodeSizer->getPosition().y + 30.f });
+	sizeSelect->addItem("Size by degree");
+	sizeSelect->addItem("Size by betweenness");
+	sizeSelect->addItem("Size by closeness");
+	sizeSelect->setSelectedItemByIndex(0);
+
+	sizeSelect->onItemSelect([&gui, &G](const tgui::String& item) {
+		G.setNodeSizing((NodeSizing)gui.get<tgui::ComboBox>("sizeSelect")->getSelectedItemIndex());
+	});
+
 	auto showLabelsCheck = tgui::CheckBox::create("Show labels");
 	showLabelsCheck->setChecked(false);
 	showLabelsCheck->setTextSize(14);
 	showLabelsCheck->getRenderer()->setTextColor(Color::White);
 	showLabelsCheck->setTextClickable(false);
-	showLabelsCheck->setPosition({ LEFT_MENU / 4,  nodeSizer->getPosition().y + 50.f });
+	showLabelsCheck->setPosition({ LEFT_MENU / 4,  sizeSelect->getPosition().y + 40.f });
 
 	showLabelsCheck->onChange([&G](bool checked) {
 		G.setShowLabels(checked);
 	});
 
+	auto bundleEdgesCheck = tgui::CheckBox::create("Bundle edges");
+	bundleEdgesCheck->setChecked(false);
+	bundleEdgesCheck->setTextSize(14);
+	bundleEdgesCheck->getRenderer()->setTextColor(Color::White);
+	bundleEdgesCheck->setTextClickable(false);
+	bundleEdgesCheck->setPosition({ LEFT_MENU / 4,  showLabelsCheck->getPosition().y + 30.f });
+
+	bundleEdgesCheck->onChange([&G](bool checked) {
+		G.setBundleEdges(checked);
+	});
+
+	auto removeOverlapsCheck = tgui::CheckBox::create("Remove overlaps");
+	removeOverlapsCheck->setChecked(true);
+	removeOverlapsCheck->setTextSize(14);
+	removeOverlapsCheck->getRenderer()->setTextColor(Color::White);
+	removeOverlapsCheck->setTextClickable(false);
+	removeOverlapsCheck->setPosition({ LEFT_MENU / 4,  bundleEdgesCheck->getPosition().y + 30.f });
+	G.setRemoveOverlaps(removeOverlapsCheck->isChecked());
+
+	removeOverlapsCheck->onChange([&G](bool checked) {
+		G.setRemoveOverlaps(checked);
+	});
+
+	auto useWeightsCheck = tgui::CheckBox::create("Use edge weights");
+	useWeightsCheck->setChecked(true);
+	useWeightsCheck->setTextSize(14);
+	useWeightsCheck->getRenderer()->setTextColor(Color::White);
+	useWeightsCheck->setTextClickable(false);
+	useWeightsCheck->setPosition({ LEFT_MENU / 4,  removeOverlapsCheck->getPosition().y + 30.f });
+
+	useWeightsCheck->onChange([&G](bool checked) {
+		G.setUseWeights(checked);
+	});
+
+	auto initSelectLabel = tgui::Label::create("Initial layout:");
+	initSelectLabel->setTextSize(14);
+	initSelectLabel->getRenderer()->setTextColor(Color::White);
+	initSelectLabel->setPosition({ LEFT_MENU / 8, useWeightsCheck->getPosition().y + 40.f });
+
+	auto initSelect = tgui::ComboBox::create();
+	initSelect->setTextSize(12);
+	initSelect->setPosition({ LEFT_MENU / 8, initSelectLabel->getPosition().y + 20.f });
+	initSelect->addItem("Random");
+	initSelect->addItem("Communities");
+	initSelect->addItem("Spanning tree");
+	initSelect->setSelectedItemByIndex(0);
+
+	auto seedLabel = tgui::Label::create("Seed:");
+	seedLabel->setTextSize(14);
+	seedLabel->getRenderer()->setTextColor(Color::White);
+	seedLabel->setPosition({ LEFT_MENU / 8, initSelect->getPosition().y + 33.f });
+
+	auto seedBox = tgui::EditBox::create();
+	seedBox->setTextSize(12);
+	seedBox->setSize({ LEFT_MENU / 2.f, 22.f });
+	seedBox->setPosition({ LEFT_MENU / 8 + 45.f, initSelect->getPosition().y + 30.f });
+	seedBox->setInputValidator(tgui::EditBox::Validator::UInt);
+	seedBox->setText(to_string(G.Seed()));
+
+	// Enter starts the layout again from the typed seed
+	seedBox->onReturnKeyPress([&gui, &G](const tgui::String& text) {
+		G.setSeed(text.toUInt(G.Seed()));
+		initialLayout(gui, G);
+		G.Reset();
+		updateWidgetsReset(gui);
+	});
+
+	auto colorCommunitiesCheck = tgui::CheckBox::create("Color communities");
+	colorCommunitiesCheck->setChecked(false);
+	colorCommunitiesCheck->setTextSize(14);
+	colorCommunitiesCheck->getRenderer()->setTextColor(Color::White);
+	colorCommunitiesCheck->setTextClickable(false);
+	colorCommunitiesCheck->setPosition({ LEFT_MENU / 4,  seedBox->getPosition().y + 35.f });
+
+	colorCommunitiesCheck->onChange([&G](bool checked) {
+		G.setColorCommunities(checked);
+	});
+
+	auto renderSelectLabel = tgui::Label::create("Render:");
+	renderSelectLabel->setTextSize(14);
+	renderSelectLabel->getRenderer()->setTextColor(Color::White);
+	renderSelectLabel->setPosition({ LEFT_MENU / 8, colorCommunitiesCheck->getPosition().y + 40.f });
+
+	auto renderSelect = tgui::ComboBox::create();
+	renderSelect->setTextSize(12);
+	renderSelect->setPosition({ LEFT_MENU / 8, renderSelectLabel->getPosition().y + 20.f });
+	renderSelect->addItem("Auto");
+	renderSelect->addItem("Nodes and edges");
+	renderSelect->addItem("Density (log)");
+	renderSelect->addItem("Density (equalized)");
+	renderSelect->setSelectedItemByIndex(0);
+
+	renderSelect->onItemSelect([&gui, &G](const tgui::String& item) {
+		applyRenderMode(gui, G);
+	});
+
+	auto orderSelectLabel = tgui::Label::create("Node order:");
+	orderSelectLabel->setTextSize(14);
+	orderSelectLabel->getRenderer()->setTextColor(Color::White);
+	orderSelectLabel->setPosition({ LEFT_MENU / 8, renderSelect->getPosition().y + 30.f });
+
+	// Memory order of the nodes, faster steps on large graphs, the picture doesn't change
+	auto orderSelect = tgui::ComboBox::create();
+	orderSelect->setTextSize(12);
+	orderSelect->setPosition({ LEFT_MENU / 8, orderSelectLabel->getPosition().y + 20.f });
+	orderSelect->addItem("File");
+	orderSelect->addItem("RCM");
+	orderSelect->addItem("Hilbert");
+	orderSelect->setSelectedItemByIndex(0);
+
+	orderSelect->onItemSelect([&gui, &G](const tgui::String& item) {
+		G.setNodeOrdering((NodeOrdering)gui.get<tgui::ComboBox>("orderSelect")->getSelectedItemIndex());
+	});
+
 	auto saveBtn = tgui::BitmapButton::create();
 	saveBtn->setImage("icons/save.png");
-	saveBtn->setPosition({ LEFT_MENU / 2.f - LEFT_MENU / 8.f, showLabelsCheck->getPosition().y + 80.f});
+	saveBtn->setPosition({ LEFT_MENU / 2.f - LEFT_MENU / 8.f, orderSelect->getPosition().y + 35.f});
 	setupControlButton(saveBtn);
 
 	saveBtn->onPress([&gui]() {
@@ -293,12 +681,49 @@ void GUI::addLeftPanel(tgui::Gui& gui, Graph& G) {
 	gui.add(playBtn, "playBtn");
 	gui.add(pauseBtn, "pauseBtn");
 	gui.add(nextBtn, "nextBtn");
+	gui.add(prevBtn, "prevBtn");
+	gui.add(historySlider, "historySlider");
 	gui.add(slider, "speedSlider");
 	gui.add(sliderLabel, "sliderLabel");
 	gui.add(kSlider, "kSlider");
 	gui.add(KsliderLabel, "kSliderLabel");
 	gui.add(nodeSizerLabel, "nodeSizerLabel");
 	gui.add(nodeSizer, "nodeSizer");
+	gui.add(sizeSelect, "sizeSelect");
 	gui.add(showLabelsCheck, "showLabels");
+	gui.add(bundleEdgesCheck, "bundleEdges");
+	gui.add(removeOverlapsCheck, "removeOverlaps");
+	gui.add(useWeightsCheck, "useWeights");
+	gui.add(initSelectLabel, "initSelectLabel");
+	gui.add(initSelect, "initSelect");
+	gui.add(seedLabel, "seedLabel");
+	gui.add(seedBox, "seed");
+	gui.add(colorCommunitiesCheck, "colorCommunities");
+	gui.add(renderSelectLabel, "renderSelectLabel");
+	gui.add(renderSelect, "renderSelect");
+	gui.add(orderSelectLabel, "orderSelectLabel");
+	gui.add(orderSelect, "orderSelect");
 	gui.add(saveBtn, "saveBtn");
+
+	// Loading progress over the canvas, shown while a file loads
+	auto loadProgress = tgui::ProgressBar::create();
+	loadProgress->setSize({ 360.f, 26.f });
+	loadProgress->setPosition({ CANVAS_OFFSET.x + CANVAS_WIDTH / 2 - 180.f, CANVAS_OFFSET.y + CANVAS_HEIGHT / 2 - 30.f });
+	loadProgress->setMinimum(0);
+	loadProgress->setMaximum(1000);
+	loadProgress->setVisible(false);
+
+	auto cancelLoad = tgui::Button::create("Cancel");
+	cancelLoad->setPosition({ CANVAS_OFFSET.x + CANVAS_WIDTH / 2 - 40.f, CANVAS_OFFSET.y + CANVAS_HEIGHT / 2 + 10.f });
+	cancelLoad->setSize({ 80.f, 26.f });
+	cancelLoad->setVisible(false);
+
+	cancelLoad->onPress([&gui]() {
+		loader().cancel();
+		gui.get<tgui::ProgressBar>("loadProgress")->setVisible(false);
+		gui.get<tgui::Button>("cancelLoad")->setVisible(false);
+	});
+
+	gui.add(loadProgress, "loadProgress");
+	gui.add(cancelLoad, "cancelLoad");
 }
\ No newline at end of file
@@ -18,6 +18,19 @@ public:
 	static void updateWidgetsStart(tgui::Gui& gui);
 	static void updateWidgetsPause(tgui::Gui& gui);
 	static void updateWidgetsReset(tgui::Gui& gui);
+
+	// Swap in a graph loaded in the background once it is ready, otherwise show the loading progress.
+	// Returns true while a file is loading
+	static bool pollLoading(tgui::Gui& gui, Graph& G);
+
+	// Remember a converged layout, so reopening the graph shows it at once
+	static void cacheLayout(const Graph& G);
+
+	// Follow the recorded layout history with the scrubber
+	static void updateHistory(tgui::Gui& gui, const Graph& G);
+
+	// Hover, select and drag nodes on the canvas
+	static void handleCanvasEvent(const sf::Event& event, Graph& G);
 	~GUI() = delete;
 
 private:
@@ -0,0 +1,496 @@
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <unordered_set>
+
+#include "LayeredLayout.hpp"
+#include "Parallel.hpp"
+
+// Horizontal space taken by a node and by a dummy node, neighbours on a layer are half of both apart
+const double NODE_WIDTH = 1.;
+const double DUMMY_WIDTH = 0.5;
+// Crossing minimization stops after this many rounds, or after this many rounds without improvement
+const int ORDER_ROUNDS = 24;
+const int ORDER_PATIENCE = 4;
+// Rounds of moving nodes between layers to shorten arcs
+const int BALANCE_PASSES = 8;
+
+// Neighbours of every node in one direction, neighbours of v are to[start[v]] .. to[start[v+1]-1]
+struct ArcLists {
+	vector<int> start, to;
+
+	ArcLists(int n, const vector<Vector2i>& arcs, bool reverse) : start(n + 1, 0), to(arcs.size()) {
+		for (const Vector2i& a : arcs)
+			start[(reverse ? a.y : a.x) + 1]++;
+		partial_sum(start.begin(), start.end(), start.begin());
+		vector<int> fill(start.begin(), start.end() - 1);
+		for (const Vector2i& a : arcs)
+			to[fill[reverse ? a.y : a.x]++] = reverse ? a.x : a.y;
+	}
+
+	int degree(int v) const { return start[v + 1] - start[v]; }
+	const int* begin(int v) const { return to.data() + start[v]; }
+	const int* end(int v) const { return to.data() + start[v + 1]; }
+};
+
+// Self loops and parallel arcs removed, back arcs of a DFS reversed so the rest is acyclic
+static vector<Vector2i> acyclicArcs(int n, const vector<Vector2i>& arcs, int& reversed)
+{
+	vector<Vector2i> simple;
+	for (const Vector2i& a : arcs) {
+		if (a.x != a.y)
+			simple.push_back(a);
+	}
+	ArcLists out(n, simple, false);
+
+	// 0 - not visited, 1 - on the DFS stack, 2 - finished
+	vector<char> state(n, 0);
+	vector<pair<int, int>> stack;
+	vector<Vector2i> result;
+	reversed = 0;
+	for (int root = 0; root < n; ++root) {
+		if (state[root])
+			continue;
+		state[root] = 1;
+		stack.push_back({ root, out.start[root] });
+		while (!stack.empty()) {
+			auto& [v, next] = stack.back();
+			if (next == out.start[v + 1]) {
+				state[v] = 2;
+				stack.pop_back();
+				continue;
+			}
+			int w = out.to[next++];
+			if (state[w] == 1) {
+				result.push_back({ w, v });
+				reversed++;
+			}
+			else {
+				result.push_back({ v, w });
+				if (state[w] == 0) {
+					state[w] = 1;
+					stack.push_back({ w, out.start[w] });
+				}
+			}
+		}
+	}
+
+	sort(result.begin(), result.end(), [](const Vector2i& a, const Vector2i& b) { return a.x != b.x ? a.x < b.x : a.y < b.y; });
+	result.erase(unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+// Longest path layering of an acyclic graph, then nodes with more arcs on one side move towards that side
+static vector<int> longestPathLayers(int n, const vector<Vector2i>& arcs)
+{
+	ArcLists out(n, arcs, false), in(n, arcs, true);
+	vector<int> inDegree(n, 0);
+	for (const Vector2i& a : arcs)
+		inDegree[a.y]++;
+
+	vector<int> layer(n, 0), queue;
+	for (int v = 0; v < n; ++v) {
+		if (inDegree[v] == 0)
+			queue.push_back(v);
+	}
+	vector<int> remaining = inDegree;
+	for (size_t head = 0; head < queue.size(); ++head) {
+		int v = queue[head];
+		for (const int* w = out.begin(v); w != out.end(v); ++w) {
+			layer[*w] = max(layer[*w], layer[v] + 1);
+			if (--remaining[*w] == 0)
+				queue.push_back(*w);
+		}
+	}
+
+	// Moving a node one layer shortens the arcs on one side and lengthens the other ones,
+	// so every move lowers the number of dummy nodes. Longest path layering leaves many long arcs behind sources.
+	for (int pass = 0; pass < BALANCE_PASSES; ++pass) {
+		bool moved = false;
+		for (auto it = queue.rbegin(); it != queue.rend(); ++it) {
+			int v = *it;
+			if (out.degree(v) <= in.degree(v))
+				continue;
+			int lowest = numeric_limits<int>::max();
+			for (const int* w = out.begin(v); w != out.end(v); ++w)
+				lowest = min(lowest, layer[*w] - 1);
+			if (lowest > layer[v]) {
+				layer[v] = lowest;
+				moved = true;
+			}
+		}
+		for (int v : queue) {
+			if (in.degree(v) <= out.degree(v))
+				continue;
+			int highest = 0;
+			for (const int* u = in.begin(v); u != in.end(v); ++u)
+				highest = max(highest, layer[*u] + 1);
+			if (highest < layer[v]) {
+				layer[v] = highest;
+				moved = true;
+			}
+		}
+		if (!moved)
+			break;
+	}
+
+	// Layers may have emptied, number them again from 0
+	vector<int> used(*max_element(layer.begin(), layer.end()) + 1, 0);
+	for (int l : layer)
+		used[l] = 1;
+	partial_sum(used.begin(), used.end(), used.begin());
+	for (int& l : layer)
+		l = used[l] - 1;
+	return layer;
+}
+
+// Crossings between two neighbouring layers, 'down' gives the neighbours on the lower one
+static long long layerCrossings(const vector<int>& upper, const vector<int>& pos, const ArcLists& down, int lowerSize)
+{
+	// Lower ends of the arcs sorted by upper end, then lower end. Every inversion is a crossing
+	vector<int> ends;
+	for (int u : upper) {
+		size_t from = ends.size();
+		for (const int* w = down.begin(u); w != down.end(u); ++w)
+			ends.push_back(pos[*w]);
+		sort(ends.begin() + from, ends.end());
+	}
+
+	int firstLeaf = 1;
+	while (firstLeaf < lowerSize)
+		firstLeaf *= 2;
+	vector<int> tree(2 * firstLeaf, 0);
+	long long crossings = 0;
+	for (int p : ends) {
+		int index = p + firstLeaf;
+		tree[index]++;
+		while (index > 1) {
+			// arcs already inserted that end to the right of p cross this one
+			if (index % 2 == 0)
+				crossings += tree[index + 1];
+			index /= 2;
+			tree[index]++;
+		}
+	}
+	return crossings;
+}
+
+static long long countCrossings(const vector<vector<int>>& layering, const vector<int>& pos, const ArcLists& down)
+{
+	int pairs = max((int)layering.size() - 1, 0);
+	vector<long long> perPair(pairs, 0);
+	parallelFor(0, pairs, [&](int l) {
+		perPair[l] = layerCrossings(layering[l], pos, down, layering[l + 1].size());
+	}, 1);
+	return accumulate(perPair.begin(), perPair.end(), 0LL);
+}
+
+static void updatePositions(const vector<vector<int>>& layering, vector<int>& pos)
+{
+	for (const vector<int>& layer : layering) {
+		for (int i = 0; i < layer.size(); ++i)
+			pos[layer[i]] = i;
+	}
+}
+
+// Order nodes on every layer, returns the number of crossings of the result
+static long long orderLayers(vector<vector<int>>& layering, vector<int>& pos, const ArcLists& up, const ArcLists& down)
+{
+	long long best = countCrossings(layering, pos, down);
+	vector<vector<int>> bestLayering = layering;
+	int layers = layering.size();
+
+	for (int round = 0, stale = 0; round < ORDER_ROUNDS && best > 0 && stale < ORDER_PATIENCE; ++round) {
+		for (int parity : { 1, 0 }) {
+			// Layers of one parity only look at layers of the other one, so they are independent
+			parallelFor(0, (layers - parity + 1) / 2, [&](int k) {
+				vector<int>& layer = layering[2 * k + parity];
+				vector<pair<double, int>> keyed(layer.size());
+				for (int i = 0; i < layer.size(); ++i) {
+					int v = layer[i];
+					double sum = 0.;
+					int count = up.degree(v) + down.degree(v);
+					for (const int* w = up.begin(v); w != up.end(v); ++w)
+						sum += pos[*w];
+					for (const int* w = down.begin(v); w != down.end(v); ++w)
+						sum += pos[*w];
+					// nodes without neighbours keep their place
+					keyed[i] = { count > 0 ? sum / count : (double)i, v };
+				}
+				stable_sort(keyed.begin(), keyed.end(), [](const pair<double, int>& a, const pair<double, int>& b) { return a.first < b.first; });
+				for (int i = 0; i < layer.size(); ++i) {
+					layer[i] = keyed[i].second;
+					pos[layer[i]] = i;
+				}
+			}, 1);
+		}
+
+		long long crossings = countCrossings(layering, pos, down);
+		if (crossings < best) {
+			best = crossings;
+			bestLayering = layering;
+			stale = 0;
+		}
+		else
+			stale++;
+	}
+
+	layering = move(bestLayering);
+	updatePositions(layering, pos);
+	return best;
+}
+
+// Brandes & Kopf coordinate assignment
+class BrandesKopf {
+public:
+	BrandesKopf(const vector<vector<int>>& layering, const vector<int>& pos, const ArcLists& up, const ArcLists& down, int realNodes)
+		: layering(layering), up(up), down(down), realNodes(realNodes), N(pos.size())
+	{
+		markType1Conflicts(pos);
+	}
+
+	vector<double> coordinates() {
+		vector<double> xs[4];
+		int smallest = 0;
+		double smallestWidth = numeric_limits<double>::infinity();
+		for (int d = 0; d < 4; ++d) {
+			bool upwards = d < 2, right = d % 2 == 1;
+			xs[d] = align(upwards, right);
+			auto [lo, hi] = minmax_element(xs[d].begin(), xs[d].end());
+			if (*hi - *lo < smallestWidth) {
+				smallestWidth = *hi - *lo;
+				smallest = d;
+			}
+		}
+
+		// Left alignments share the left border of the narrowest one, right alignments the right border
+		auto [alignLo, alignHi] = minmax_element(xs[smallest].begin(), xs[smallest].end());
+		double targetLo = *alignLo, targetHi = *alignHi;
+		for (int d = 0; d < 4; ++d) {
+			auto [lo, hi] = minmax_element(xs[d].begin(), xs[d].end());
+			double shift = d % 2 == 0 ? targetLo - *lo : targetHi - *hi;
+			for (double& x : xs[d])
+				x += shift;
+		}
+
+		// Average of the two median candidates
+		vector<double> x(N);
+		for (int v = 0; v < N; ++v) {
+			double c[4] = { xs[0][v], xs[1][v], xs[2][v], xs[3][v] };
+			sort(c, c + 4);
+			x[v] = (c[1] + c[2]) / 2;
+		}
+		return x;
+	}
+
+private:
+	const vector<vector<int>>& layering;
+	const ArcLists& up;
+	const ArcLists& down;
+	int realNodes, N;
+	// Arcs crossing an inner segment (an arc between two dummies), they are not aligned
+	unordered_set<long long> conflicts;
+
+	bool dummy(int v) const { return v >= realNodes; }
+	long long key(int a, int b) const { return (long long)min(a, b) * N + max(a, b); }
+
+	void markType1Conflicts(const vector<int>& pos) {
+		for (int l = 1; l < layering.size(); ++l) {
+			const vector<int>& layer = layering[l];
+			int prevSize = layering[l - 1].size();
+			int k0 = 0, scan = 0;
+			for (int i = 0; i < layer.size(); ++i) {
+				int v = layer[i];
+				int inner = -1;
+				if (dummy(v)) {
+					for (const int* u = up.begin(v); u != up.end(v); ++u) {
+						if (dummy(*u))
+							inner = *u;
+					}
+				}
+				if (inner < 0 && i + 1 < layer.size())
+					continue;
+				int k1 = inner >= 0 ? pos[inner] : prevSize;
+				for (; scan <= i; ++scan) {
+					int w = layer[scan];
+					for (const int* u = up.begin(w); u != up.end(w); ++u) {
+						if ((pos[*u] < k0 || pos[*u] > k1) && !(dummy(*u) && dummy(w)))
+							conflicts.insert(key(*u, w));
+					}
+				}
+				k0 = k1;
+			}
+		}
+	}
+
+	// One of the four alignments: blocks built from the top (upwards neighbours) or the bottom, packed to the left or right
+	vector<double> align(bool fromTop, bool right) {
+		int layers = layering.size();
+		auto layerAt = [&](int l) -> const vector<int>& { return layering[fromTop ? l : layers - 1 - l]; };
+		vector<int> p(N), root(N), next(N);
+		for (int l = 0; l < layers; ++l) {
+			const vector<int>& layer = layerAt(l);
+			for (int i = 0; i < layer.size(); ++i) {
+				int v = layer[i];
+				p[v] = right ? layer.size() - 1 - i : i;
+				root[v] = next[v] = v;
+			}
+		}
+		const ArcLists& neighbours = fromTop ? up : down;
+
+		// Vertical alignment, every node joins the block of a median neighbour if that doesn't cross an earlier alignment
+		vector<int> medians;
+		for (int l = 0; l < layers; ++l) {
+			const vector<int>& layer = layerAt(l);
+			int previous = -1;
+			for (int i = 0; i < layer.size(); ++i) {
+				int v = layer[right ? layer.size() - 1 - i : i];
+				medians.assign(neighbours.begin(v), neighbours.end(v));
+				if (medians.empty())
+					continue;
+				sort(medians.begin(), medians.end(), [&](int a, int b) { return p[a] < p[b]; });
+				int d = medians.size();
+				for (int m = (d - 1) / 2; m <= d / 2; ++m) {
+					int w = medians[m];
+					if (next[v] == v && previous < p[w] && !conflicts.count(key(v, w))) {
+						next[w] = v;
+						root[v] = root[w];
+						next[v] = root[v];
+						previous = p[w];
+					}
+				}
+			}
+		}
+
+		// Block graph, an arc from the block of every node to the block of its right neighbour
+		vector<Vector2i> blockArcs;
+		vector<double> blockSeparation;
+		for (int l = 0; l < layers; ++l) {
+			const vector<int>& layer = layerAt(l);
+			for (int i = 1; i < layer.size(); ++i) {
+				int u = layer[right ? layer.size() - i : i - 1];
+				int v = layer[right ? layer.size() - 1 - i : i];
+				blockArcs.push_back({ root[u], root[v] });
+				blockSeparation.push_back(((dummy(u) ? DUMMY_WIDTH : NODE_WIDTH) + (dummy(v) ? DUMMY_WIDTH : NODE_WIDTH)) / 2);
+			}
+		}
+		vector<int> arcIndex(blockArcs.size());
+		iota(arcIndex.begin(), arcIndex.end(), 0);
+		vector<Vector2i> indexed(blockArcs.size());
+		for (int k = 0; k < blockArcs.size(); ++k)
+			indexed[k] = { blockArcs[k].x, k };
+		ArcLists outIndex(N, indexed, false);
+		for (int k = 0; k < blockArcs.size(); ++k)
+			indexed[k] = { blockArcs[k].y, k };
+		ArcLists inIndex(N, indexed, false);
+
+		// Topological order of the blocks
+		vector<int> remaining(N, 0), order;
+		for (const Vector2i& a : blockArcs)
+			remaining[a.y]++;
+		for (int v = 0; v < N; ++v) {
+			if (root[v] == v && remaining[v] == 0)
+				order.push_back(v);
+		}
+		for (size_t head = 0; head < order.size(); ++head) {
+			int b = order[head];
+			for (const int* k = outIndex.begin(b); k != outIndex.end(b); ++k) {
+				if (--remaining[blockArcs[*k].y] == 0)
+					order.push_back(blockArcs[*k].y);
+			}
+		}
+
+		// Horizontal compaction, blocks as far left as the separations allow, then right up to their right neighbours
+		vector<double> x(N, 0.);
+		for (int b : order) {
+			for (const int* k = inIndex.begin(b); k != inIndex.end(b); ++k)
+				x[b] = max(x[b], x[blockArcs[*k].x] + blockSeparation[*k]);
+		}
+		for (auto it = order.rbegin(); it != order.rend(); ++it) {
+			int b = *it;
+			double limit = numeric_limits<double>::infinity();
+			for (const int* k = outIndex.begin(b); k != outIndex.end(b); ++k)
+				limit = min(limit, x[blockArcs[*k].y] - blockSeparation[*k]);
+			if (limit != numeric_limits<double>::infinity())
+				x[b] = max(x[b], limit);
+		}
+
+		vector<double> xs(N);
+		for (int v = 0; v < N; ++v)
+			xs[v] = right ? -x[root[v]] : x[root[v]];
+		return xs;
+	}
+};
+
+LayeredStats layeredLayout(int n, const vector<Vector2i>& arcs, Vector2f center, Vector2f size, vector<Vector2f>& positions)
+{
+	LayeredStats stats;
+	if (n == 0)
+		return stats;
+
+	vector<Vector2i> acyclic = acyclicArcs(n, arcs, stats.reversed);
+	vector<int> layer = longestPathLayers(n, acyclic);
+
+	// Proper layering, long arcs are split by dummy nodes
+	vector<Vector2i> proper;
+	for (const Vector2i& a : acyclic) {
+		int from = a.x;
+		for (int l = layer[a.x] + 1; l < layer[a.y]; ++l) {
+			int dummy = layer.size();
+			layer.push_back(l);
+			proper.push_back({ from, dummy });
+			from = dummy;
+		}
+		proper.push_back({ from, a.y });
+	}
+	int N = layer.size();
+	stats.dummies = N - n;
+	stats.layers = *max_element(layer.begin(), layer.end()) + 1;
+	ArcLists up(N, proper, true), down(N, proper, false);
+
+	// Initial order by a DFS along the arcs, started from the nodes of the top layers first
+	vector<vector<int>> layering(stats.layers);
+	vector<int> starts(N);
+	iota(starts.begin(), starts.end(), 0);
+	stable_sort(starts.begin(), starts.end(), [&](int a, int b) { return layer[a] < layer[b]; });
+	vector<char> visited(N, 0);
+	vector<int> stack;
+	for (int s : starts) {
+		if (visited[s])
+			continue;
+		visited[s] = 1;
+		stack.push_back(s);
+		while (!stack.empty()) {
+			int v = stack.back();
+			stack.pop_back();
+			layering[layer[v]].push_back(v);
+			for (const int* w = down.end(v); w != down.begin(v); ) {
+				--w;
+				if (!visited[*w]) {
+					visited[*w] = 1;
+					stack.push_back(*w);
+				}
+			}
+		}
+	}
+	vector<int> pos(N);
+	updatePositions(layering, pos);
+
+	stats.crossings = orderLayers(layering, pos, up, down);
+	vector<double> x = BrandesKopf(layering, pos, up, down, n).coordinates();
+
+	double lo = numeric_limits<double>::infinity(), hi = -lo;
+	for (int v = 0; v < N; ++v) {
+		lo = min(lo, x[v]);
+		hi = max(hi, x[v]);
+	}
+	double width = hi - lo;
+	int height = stats.layers - 1;
+	for (int v = 0; v < n; ++v) {
+		float px = width > 0 ? (float)((x[v] - lo) / width) - 0.5f : 0.f;
+		float py = height > 0 ? layer[v] / (float)height - 0.5f : 0.f;
+		positions[v] = { center.x + px * size.x, center.y + py * size.y };
+	}
+	return stats;
+}
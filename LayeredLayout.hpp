@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <SFML/System/Vector2.hpp>
+
+using namespace std;
+using namespace sf;
+
+// What the layered layout ended up with, for diagnostics
+struct LayeredStats {
+	int layers = 0;
+	// arcs turned around to break cycles
+	int reversed = 0;
+	// extra nodes on layers crossed by long arcs
+	int dummies = 0;
+	// arc crossings between neighbouring layers, counted with the dummy nodes
+	long long crossings = 0;
+};
+
+/* Layered drawing of a directed graph (Sugiyama, Tagawa & Toda, 1981)
+*
+* 1. Cycles are broken by reversing the back arcs of a depth-first search.
+* 2. Longest path layering, then sources move down next to their highest successor so arcs get shorter.
+* 3. Arcs spanning several layers get a dummy node on every layer in between.
+* 4. Crossings are reduced by barycenter sweeps. Odd and even layers take turns, so all layers of one parity
+*    are ordered at the same time against their fixed neighbours. The order with the fewest crossings
+*    (counted with the accumulator tree of Barth, Mutzel & Junger) is kept.
+* 5. x coordinates by Brandes & Kopf (2001): four vertical alignments compacted and balanced.
+*
+* Arcs go from arcs[k].x to arcs[k].y, layers are drawn top to bottom fitted into the rectangle centered at 'center'.
+*/
+LayeredStats layeredLayout(int n, const vector<Vector2i>& arcs, Vector2f center, Vector2f size, vector<Vector2f>& positions);
@@ -0,0 +1,245 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+
+#include "LayoutCache.hpp"
+
+namespace fs = std::filesystem;
+
+// Entry files start with this, followed by a format version
+const uint32_t CACHE_MAGIC = 0x43564754; // "TGVC"
+const uint32_t CACHE_VERSION = 1;
+const char* INDEX_FILE = "index.txt";
+const uint64_t EMPTY_BUCKET = UINT64_MAX;
+
+uint64_t hashMix(uint64_t x)
+{
+	// splitmix64 finalizer
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+	// FNV-1a
+	uint64_t h = 0xcbf29ce484222325ull ^ seed;
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i) {
+		h ^= p[i];
+		h *= 0x100000001b3ull;
+	}
+	return hashMix(h);
+}
+
+LayoutCache::LayoutCache(string directory, uint64_t maxBytes) : directory(directory), maxBytes(maxBytes)
+{
+	loadIndex();
+}
+
+LayoutCache::Signature LayoutCache::signature(const vector<uint64_t>& labelHashes, const vector<Vector2i>& edges, bool directed)
+{
+	// One permutation hashing: the top bits of an edge hash pick the bucket, every bucket keeps its smallest hash
+	Signature sig;
+	sig.fill(EMPTY_BUCKET);
+	for (const Vector2i& e : edges) {
+		uint64_t a = labelHashes[e.x], b = labelHashes[e.y];
+		if (!directed && a > b)
+			swap(a, b);
+		uint64_t h = hashMix(a * 0x9e3779b97f4a7c15ull + b);
+		uint64_t& bucket = sig[h >> 58];
+		bucket = min(bucket, h & (EMPTY_BUCKET >> 6));
+	}
+	return sig;
+}
+
+float LayoutCache::similarity(const Signature& a, const Signature& b)
+{
+	int used = 0, same = 0;
+	for (int k = 0; k < SIGNATURE_SIZE; ++k) {
+		if (a[k] == EMPTY_BUCKET && b[k] == EMPTY_BUCKET)
+			continue;
+		used++;
+		if (a[k] == b[k])
+			same++;
+	}
+	return used ? same / (float)used : 0.f;
+}
+
+string LayoutCache::entryPath(uint64_t key) const
+{
+	ostringstream name;
+	name << hex << setw(16) << setfill('0') << key << ".layout";
+	return (fs::path(directory) / name.str()).string();
+}
+
+bool LayoutCache::read(uint64_t key, vector<string>* labels, vector<Vector2f>& positions) const
+{
+	string path = entryPath(key);
+	error_code ec;
+	uint64_t left = fs::file_size(path, ec);
+	ifstream in(path, ios::binary);
+	uint32_t header[3];
+	if (ec || !in.read((char*)header, sizeof(header)) || header[0] != CACHE_MAGIC || header[1] != CACHE_VERSION)
+		return false;
+	left -= sizeof(header);
+	// Sizes come from the file, check them against it before allocating, a damaged entry could ask for gigabytes
+	uint32_t n = header[2];
+	if ((uint64_t)n * (sizeof(uint32_t) + sizeof(Vector2f)) > left)
+		return false;
+	left -= (uint64_t)n * sizeof(Vector2f);
+	if (labels)
+		labels->resize(n);
+	for (uint32_t i = 0; i < n; ++i) {
+		uint32_t length;
+		if (!in.read((char*)&length, sizeof(length)))
+			return false;
+		if (sizeof(length) + (uint64_t)length > left)
+			return false;
+		left -= sizeof(length) + length;
+		if (labels) {
+			(*labels)[i].resize(length);
+			in.read(&(*labels)[i][0], length);
+		}
+		else
+			in.ignore(length);
+	}
+	positions.resize(n);
+	return (bool)in.read((char*)positions.data(), n * sizeof(Vector2f));
+}
+
+void LayoutCache::touch(Entry& entry)
+{
+	entry.lastUse = ++clock;
+	saveIndex();
+}
+
+void LayoutCache::remove(size_t index)
+{
+	error_code ec;
+	fs::remove(entryPath(entries[index].key), ec);
+	entries.erase(entries.begin() + index);
+}
+
+bool LayoutCache::find(uint64_t key, vector<Vector2f>& positions)
+{
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].key != key)
+			continue;
+		if (!read(key, nullptr, positions)) {
+			// file went missing or is damaged
+			remove(i);
+			saveIndex();
+			return false;
+		}
+		touch(entries[i]);
+		return true;
+	}
+	return false;
+}
+
+bool LayoutCache::findNearest(const Signature& signature, int algorithm, float minSimilarity, vector<string>& labels, vector<Vector2f>& positions, float& similarity)
+{
+	int best = -1;
+	bool bestSame = false;
+	float bestSimilarity = minSimilarity;
+	for (int i = 0; i < entries.size(); ++i) {
+		float s = LayoutCache::similarity(signature, entries[i].signature);
+		bool same = entries[i].algorithm == algorithm;
+		if (s < minSimilarity || (bestSame && !same))
+			continue;
+		if ((same && !bestSame) || s >= bestSimilarity) {
+			best = i;
+			bestSame = same;
+			bestSimilarity = s;
+		}
+	}
+	if (best < 0 || !read(entries[best].key, &labels, positions))
+		return false;
+	similarity = bestSimilarity;
+	touch(entries[best]);
+	return true;
+}
+
+void LayoutCache::store(uint64_t key, const Signature& signature, int algorithm, const vector<string>& labels, const vector<Vector2f>& positions)
+{
+	error_code ec;
+	fs::create_directories(directory, ec);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].key == key) {
+			remove(i);
+			break;
+		}
+	}
+
+	string path = entryPath(key);
+	{
+		ofstream out(path, ios::binary);
+		uint32_t header[3] = { CACHE_MAGIC, CACHE_VERSION, (uint32_t)positions.size() };
+		out.write((const char*)header, sizeof(header));
+		for (const string& label : labels) {
+			uint32_t length = label.size();
+			out.write((const char*)&length, sizeof(length));
+			out.write(label.data(), length);
+		}
+		out.write((const char*)positions.data(), positions.size() * sizeof(Vector2f));
+		if (!out) {
+			out.close();
+			fs::remove(path, ec);
+			return;
+		}
+	}
+	entries.push_back({ key, (uint64_t)fs::file_size(path, ec), ++clock, signature, algorithm });
+
+	// Least recently used entries go first, the new one is kept even if it alone is over the limit
+	while (bytes() > maxBytes && entries.size() > 1) {
+		auto oldest = min_element(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+		remove(oldest - entries.begin());
+	}
+	saveIndex();
+}
+
+uint64_t LayoutCache::bytes() const
+{
+	uint64_t total = 0;
+	for (const Entry& e : entries)
+		total += e.bytes;
+	return total;
+}
+
+void LayoutCache::loadIndex()
+{
+	// '<key> <bytes> <last use> <signature...> <algorithm>' per line, numbers in hex except the algorithm
+	ifstream in(fs::path(directory) / INDEX_FILE);
+	string line;
+	while (getline(in, line)) {
+		istringstream fields(line);
+		Entry e;
+		fields >> hex >> e.key >> e.bytes >> e.lastUse;
+		for (uint64_t& bucket : e.signature)
+			fields >> bucket;
+		if (!fields)
+			continue;
+		if (!(fields >> dec >> e.algorithm))
+			e.algorithm = -1;
+		clock = max(clock, e.lastUse);
+		entries.push_back(e);
+	}
+}
+
+void LayoutCache::saveIndex() const
+{
+	ofstream out(fs::path(directory) / INDEX_FILE);
+	out << hex;
+	for (const Entry& e : entries) {
+		out << e.key << ' ' << e.bytes << ' ' << e.lastUse;
+		for (uint64_t bucket : e.signature)
+			out << ' ' << bucket;
+		out << ' ' << dec << e.algorithm << hex << '\n';
+	}
+}
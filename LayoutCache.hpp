@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <SFML/System/Vector2.hpp>
+
+using namespace std;
+using namespace sf;
+
+// Hashes used for cache keys
+uint64_t hashMix(uint64_t x);
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+/* Persistent cache of converged layouts
+*
+* Every entry is a file '<key>.layout' in the cache directory with the node labels and positions.
+* The key is a hash of the graph (nodes, edges, weights) and of the algorithm and its parameters, so an
+* unchanged graph laid out with the same settings finds its layout again.
+* For graphs that changed a little every entry also keeps a MinHash signature of its edge set (one permutation
+* hashing over edges between labels), the entry with the most similar edges can seed the layout instead.
+* Entries made by the same algorithm are preferred, layouts of different algorithms can look nothing alike.
+* An index file keeps keys, sizes, signatures, algorithms and last use. Least recently used entries are deleted once
+* the files take more than 'maxBytes'.
+*/
+class LayoutCache
+{
+public:
+	static const int SIGNATURE_SIZE = 64;
+	using Signature = array<uint64_t, SIGNATURE_SIZE>;
+
+	LayoutCache(string directory, uint64_t maxBytes = 256ull << 20);
+
+	// Signature of an edge set, 'labelHashes' are hashes of the node labels
+	static Signature signature(const vector<uint64_t>& labelHashes, const vector<Vector2i>& edges, bool directed);
+	// Estimated Jaccard similarity of the edge sets with these signatures
+	static float similarity(const Signature& a, const Signature& b);
+
+	// Positions stored under 'key', false if there are none
+	bool find(uint64_t key, vector<Vector2f>& positions);
+	// Labels and positions of the entry with the most similar signature, false if none is at least 'minSimilarity'.
+	// Entries made by 'algorithm' win over more similar ones made by another algorithm
+	bool findNearest(const Signature& signature, int algorithm, float minSimilarity, vector<string>& labels, vector<Vector2f>& positions, float& similarity);
+	// Store a layout made by 'algorithm', replacing an entry with the same key
+	void store(uint64_t key, const Signature& signature, int algorithm, const vector<string>& labels, const vector<Vector2f>& positions);
+
+	size_t size() const { return entries.size(); }
+	uint64_t bytes() const;
+private:
+	struct Entry {
+		uint64_t key;
+		uint64_t bytes;
+		uint64_t lastUse;
+		Signature signature;
+		// -1 for entries of older indexes, which didn't record it
+		int algorithm;
+	};
+
+	string directory;
+	uint64_t maxBytes;
+	vector<Entry> entries;
+	uint64_t clock = 0;
+
+	string entryPath(uint64_t key) const;
+	bool read(uint64_t key, vector<string>* labels, vector<Vector2f>& positions) const;
+	void touch(Entry& entry);
+	void remove(size_t index);
+	void loadIndex();
+	void saveIndex() const;
+};
@@ -0,0 +1,116 @@
+#include <cmath>
+
+#include "LayoutHistory.hpp"
+
+// Frames per group, a new keyframe starts every KEYFRAME_INTERVAL frames
+const int KEYFRAME_INTERVAL = 32;
+// Quantization step of position differences, in pixels
+const float QUANT = 1.f / 64.f;
+
+static void putVarint(vector<uint8_t>& out, int32_t v) {
+	// zigzag, small negative numbers become small positive ones
+	uint32_t u = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+	while (u >= 0x80) {
+		out.push_back((uint8_t)(u | 0x80));
+		u >>= 7;
+	}
+	out.push_back((uint8_t)u);
+}
+
+static int32_t getVarint(const uint8_t*& p) {
+	uint32_t u = 0;
+	int shift = 0;
+	while (*p & 0x80) {
+		u |= (uint32_t)(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	u |= (uint32_t)(*p++) << shift;
+	return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+void LayoutHistory::record(const vector<Vector2f>& positions, State state)
+{
+	if (groups.empty() || groups.back().deltas.size() + 1 >= KEYFRAME_INTERVAL || positions.size() != current.size()) {
+		Group g{ last() + 1, positions, {}, { state }, positions.size() * sizeof(Vector2f) };
+		if (groups.empty())
+			g.first = 0;
+		total += g.bytes;
+		groups.push_back(move(g));
+		current = positions;
+	}
+	else {
+		Group& g = groups.back();
+		vector<uint8_t> delta;
+		delta.reserve(positions.size() * 2);
+		for (size_t i = 0; i < positions.size(); ++i) {
+			int32_t dx = (int32_t)lround((positions[i].x - current[i].x) / QUANT);
+			int32_t dy = (int32_t)lround((positions[i].y - current[i].y) / QUANT);
+			putVarint(delta, dx);
+			putVarint(delta, dy);
+			// advance exactly like decoding will
+			current[i].x += dx * QUANT;
+			current[i].y += dy * QUANT;
+		}
+		delta.shrink_to_fit();
+		g.bytes += delta.size();
+		total += delta.size();
+		g.deltas.push_back(move(delta));
+		g.states.push_back(state);
+	}
+
+	// Drop the oldest groups, always keep the newest one
+	while (total > budget && groups.size() > 1) {
+		total -= groups.front().bytes;
+		groups.pop_front();
+	}
+}
+
+void LayoutHistory::decode(const Group& g, int frame, vector<Vector2f>& positions) const
+{
+	positions = g.key;
+	for (int f = g.first + 1; f <= frame; ++f) {
+		const uint8_t* p = g.deltas[f - g.first - 1].data();
+		for (Vector2f& pos : positions) {
+			pos.x += getVarint(p) * QUANT;
+			pos.y += getVarint(p) * QUANT;
+		}
+	}
+}
+
+LayoutHistory::State LayoutHistory::restore(int frame, vector<Vector2f>& positions) const
+{
+	for (const Group& g : groups) {
+		if (frame >= g.first && frame <= g.first + (int)g.deltas.size()) {
+			decode(g, frame, positions);
+			return g.states[frame - g.first];
+		}
+	}
+	return State{};
+}
+
+void LayoutHistory::truncate(int frame)
+{
+	while (!groups.empty() && groups.back().first > frame) {
+		total -= groups.back().bytes;
+		groups.pop_back();
+	}
+	if (groups.empty()) {
+		current.clear();
+		return;
+	}
+	Group& g = groups.back();
+	while (g.first + (int)g.deltas.size() > frame) {
+		g.bytes -= g.deltas.back().size();
+		total -= g.deltas.back().size();
+		g.deltas.pop_back();
+		g.states.pop_back();
+	}
+	decode(g, frame, current);
+}
+
+void LayoutHistory::clear()
+{
+	groups.clear();
+	current.clear();
+	total = 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <SFML/System/Vector2.hpp>
+
+using namespace std;
+using namespace sf;
+
+/* Bounded history of layout states
+*
+* Frames are grouped: every group starts with a keyframe holding the exact positions, the following
+* frames store position differences to the previous frame, quantized and varint encoded, so a small step
+* costs a byte or two per coordinate. Differences are taken to the previous frame as it will be decoded,
+* so quantization errors don't add up along a group.
+* Oldest groups are dropped once the history is over its memory budget. Any frame is restored by decoding
+* at most one group.
+*/
+class LayoutHistory
+{
+public:
+	// Simulation state stored next to the positions of every frame
+	struct State {
+		int iteration = 0;
+		float temp = 0.f;
+		// Stress SGD epoch and ForceAtlas2 speed, so a rewound run continues where it was
+		int epoch = 0;
+		float speed = 0.f;
+	};
+
+	LayoutHistory(size_t budget = 64 << 20) : budget(budget) {}
+
+	// Append a frame
+	void record(const vector<Vector2f>& positions, State state);
+	// Restore frame number 'frame' (first() <= frame <= last()), returns its state
+	State restore(int frame, vector<Vector2f>& positions) const;
+	// Drop all frames after 'frame'
+	void truncate(int frame);
+	void clear();
+
+	bool empty() const { return groups.empty(); }
+	// Numbers of the oldest and newest frame kept, frame numbers keep growing when old frames are dropped
+	int first() const { return groups.empty() ? 0 : groups.front().first; }
+	int last() const { return groups.empty() ? -1 : groups.back().first + (int)groups.back().deltas.size(); }
+	size_t bytes() const { return total; }
+private:
+	struct Group {
+		// number of the keyframe
+		int first;
+		vector<Vector2f> key;
+		// encoded differences of frames first+1, first+2, ...
+		vector<vector<uint8_t>> deltas;
+		vector<State> states;
+		size_t bytes;
+	};
+
+	// Decode frames of group g up to and including 'frame' into positions
+	void decode(const Group& g, int frame, vector<Vector2f>& positions) const;
+
+	deque<Group> groups;
+	// newest frame as decoding will reproduce it, deltas are taken against it
+	vector<Vector2f> current;
+	size_t budget;
+	size_t total = 0;
+};
@@ -0,0 +1,465 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <memory>
+
+#include "LayoutService.hpp"
+#include "Socket.hpp"
+#include "Graph.hpp"
+#include "Batch.hpp"
+#include "Util.hpp"
+#include "ThreadPool.hpp"
+
+using SteadyClock = chrono::steady_clock;
+
+// Latency and queue time samples kept for percentiles
+const size_t LATENCY_SAMPLES = 1024;
+// Largest request payload accepted
+const size_t MAX_REQUEST_BYTES = size_t(1) << 30;
+// How often a session waiting for replies checks whether its client is still there
+const auto DISCONNECT_CHECK = chrono::milliseconds(100);
+const char* SERVICE_ALGORITHMS[] = { "fr", "linlog", "fa2", "sgd", "tree", "radial", "layered", "auto" };
+
+static double msSince(SteadyClock::time_point t) {
+	return chrono::duration<double, milli>(SteadyClock::now() - t).count();
+}
+
+static double percentile(vector<double> samples, double p) {
+	if (samples.empty())
+		return 0.;
+	sort(samples.begin(), samples.end());
+	int index = max(0, min(int(samples.size()) - 1, int(ceil(p * samples.size())) - 1));
+	return samples[index];
+}
+
+// Replies of one layout, written by time slices on the pool and sent by the session thread
+struct Outbox {
+	struct Message {
+		string data;
+		// intermediate frames may be dropped, everything else is sent
+		bool droppable;
+		bool last;
+	};
+	mutex m;
+	condition_variable ready;
+	deque<Message> messages;
+	int droppable = 0;
+};
+
+struct Job {
+	Graph G;
+	string algorithm = "fr";
+	float C;
+	unsigned seed = 0;
+	int maxIterations;
+	int frameEvery = 0;
+	bool started = false;
+	int iterations = 0;
+	bool converged = false;
+	SteadyClock::time_point received;
+	double queueMs = -1., runMs = 0.;
+	// the client went away
+	atomic<bool> cancelled{ false };
+	Outbox out;
+};
+
+class Service {
+public:
+	explicit Service(const ServiceOptions& options) : options(options) {}
+	// Count a new connection, false if there are already options.maxSessions
+	bool openSession();
+	// Handle a connection opened by openSession() until the client quits or disconnects
+	void session(Socket client, int id);
+	string stats();
+private:
+	ServiceOptions options;
+
+	mutex m;
+	condition_variable slotFree;
+	int active = 0, queued = 0;
+	// Layouts waiting for their next time slice, oldest first
+	deque<shared_ptr<Job>> runQueue;
+	int sessions = 0, completed = 0, refused = 0;
+	long long droppedFrames = 0;
+	vector<double> latencies, queueTimes;
+	size_t nextSample = 0;
+
+	// Wait for a free layout slot, false if too many requests are already waiting
+	bool admit();
+	// Give back a slot taken by admit()
+	void release();
+	void schedule(shared_ptr<Job> job);
+	// Run the oldest waiting layout for one time slice
+	void runNext();
+	void post(Job& job, string data, bool droppable, bool last = false);
+	string frame(Job& job);
+};
+
+bool Service::admit()
+{
+	unique_lock<mutex> lock(m);
+	if (active >= options.maxActive && queued >= options.maxQueued) {
+		refused++;
+		return false;
+	}
+	queued++;
+	slotFree.wait(lock, [this] { return active < options.maxActive; });
+	queued--;
+	active++;
+	return true;
+}
+
+void Service::release()
+{
+	{
+		lock_guard<mutex> lock(m);
+		active--;
+	}
+	slotFree.notify_one();
+}
+
+bool Service::openSession()
+{
+	lock_guard<mutex> lock(m);
+	if (sessions >= options.maxSessions)
+		return false;
+	sessions++;
+	return true;
+}
+
+void Service::schedule(shared_ptr<Job> job)
+{
+	{
+		lock_guard<mutex> lock(m);
+		runQueue.push_back(move(job));
+	}
+	// One pool task per queued layout, each takes whichever is oldest
+	ThreadPool::global().submit([this]() { runNext(); });
+}
+
+void Service::post(Job& job, string data, bool droppable, bool last)
+{
+	{
+		lock_guard<mutex> lock(job.out.m);
+		auto& messages = job.out.messages;
+		if (droppable && job.out.droppable >= options.frameQueue) {
+			// Slow client, drop the oldest frame waiting to be sent
+			auto oldest = find_if(messages.begin(), messages.end(), [](const Outbox::Message& msg) { return msg.droppable; });
+			messages.erase(oldest);
+			job.out.droppable--;
+			lock_guard<mutex> statsLock(m);
+			droppedFrames++;
+		}
+		messages.push_back({ move(data), droppable, last });
+		if (droppable)
+			job.out.droppable++;
+	}
+	job.out.ready.notify_one();
+}
+
+string Service::frame(Job& job)
+{
+	const vector<Vector2f>& positions = job.G.Positions();
+	string header = "FRAME " + to_string(job.iterations) + " " + to_string(positions.size()) + "\n";
+	string data(header.size() + positions.size() * sizeof(Vector2f), '\0');
+	memcpy(&data[0], header.data(), header.size());
+	memcpy(&data[header.size()], positions.data(), positions.size() * sizeof(Vector2f));
+	return data;
+}
+
+void Service::runNext()
+{
+	shared_ptr<Job> job;
+	{
+		lock_guard<mutex> lock(m);
+		job = move(runQueue.front());
+		runQueue.pop_front();
+	}
+
+	auto start = SteadyClock::now();
+	if (job->queueMs < 0)
+		job->queueMs = msSince(job->received);
+	bool finished = job->cancelled, failed = false;
+	try {
+		if (!job->started && !finished) {
+			// Setup can take a while (stress layout distances), so it runs in the slice as well
+			job->G.setSeed(job->seed);
+			job->G.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+			configureAlgorithm(job->G, job->algorithm, job->C);
+			job->started = true;
+		}
+		while (!finished) {
+			bool running = job->G.Update();
+			job->iterations++;
+			job->converged = !running;
+			finished = !running || job->iterations >= job->maxIterations || job->runMs + msSince(start) >= options.budgetMs
+				|| job->cancelled;
+			if (!finished && job->frameEvery > 0 && job->iterations % job->frameEvery == 0)
+				post(*job, frame(*job), true);
+			if (msSince(start) >= options.sliceMs)
+				break;
+		}
+	}
+	catch (const exception& e) {
+		post(*job, string("ERROR ") + e.what() + "\n", false, true);
+		finished = failed = true;
+	}
+	job->runMs += msSince(start);
+
+	if (!finished) {
+		schedule(job);
+		return;
+	}
+	if (job->cancelled) {
+		// the session waits for a last message even if nobody reads it anymore
+		post(*job, "ERROR cancelled\n", false, true);
+	}
+	else if (!failed) {
+		post(*job, frame(*job), false);
+		ostringstream done;
+		done << "DONE " << job->iterations << ' ' << job->converged << ' ' << job->queueMs << ' ' << job->runMs << '\n';
+		post(*job, done.str(), false, true);
+	}
+	release();
+}
+
+// Graph from the payload of a LAYOUT request
+static Graph parseGraph(const string& format, const string& payload)
+{
+	if (format == "edgelist") {
+		istringstream src(payload);
+		return Graph::fromEdgeList(src);
+	}
+	if (format != "binary")
+		throw invalid_argument("unknown format " + format);
+
+	int32_t header[2];
+	if (payload.size() < sizeof(header))
+		throw invalid_argument("binary graph too short");
+	memcpy(header, payload.data(), sizeof(header));
+	int32_t n = header[0], m = header[1];
+	struct Record { int32_t source, target; float weight; };
+	if (n < 0 || m < 0 || payload.size() != sizeof(header) + size_t(m) * sizeof(Record))
+		throw invalid_argument("binary graph size doesn't match n and m");
+
+	vector<Node> nodes;
+	nodes.reserve(n);
+	for (int i = 0; i < n; ++i)
+		nodes.push_back(Node::from_id(i));
+	vector<Edge> edges;
+	edges.reserve(m);
+	const char* p = payload.data() + sizeof(header);
+	for (int k = 0; k < m; ++k, p += sizeof(Record)) {
+		Record r;
+		memcpy(&r, p, sizeof(r));
+		if (r.source < 0 || r.source >= n || r.target < 0 || r.target >= n)
+			throw invalid_argument("edge " + to_string(k) + " has a node out of range");
+		edges.push_back(Edge(r.source, r.target, r.weight));
+	}
+	return Graph(nodes, edges);
+}
+
+void Service::session(Socket client, int id)
+{
+	string line;
+	while (client.readLine(line)) {
+		istringstream words(line);
+		string command;
+		words >> command;
+		if (command == "QUIT")
+			break;
+		if (command == "STATS") {
+			if (!client.writeAll(stats()))
+				break;
+			continue;
+		}
+		if (command != "LAYOUT") {
+			if (!client.writeAll("ERROR unknown command " + command + "\n"))
+				break;
+			continue;
+		}
+
+		string format;
+		size_t bytes = 0;
+		words >> format >> bytes;
+		if (!words || bytes > MAX_REQUEST_BYTES) {
+			// without a valid size the rest of the stream can't be parsed
+			client.writeAll("ERROR expected 'LAYOUT <format> <bytes>' with at most " + to_string(MAX_REQUEST_BYTES) + " bytes\n");
+			break;
+		}
+
+		auto job = make_shared<Job>();
+		job->received = SteadyClock::now();
+		job->C = options.C;
+		job->maxIterations = options.maxIterations;
+		string error;
+		try {
+			string option;
+			while (words >> option) {
+				size_t eq = option.find('=');
+				string key = option.substr(0, eq), value = eq == string::npos ? "" : option.substr(eq + 1);
+				if (key == "algorithm")
+					job->algorithm = value;
+				else if (key == "iterations")
+					job->maxIterations = min(stoi(value), options.maxIterations);
+				else if (key == "frames")
+					job->frameEvery = stoi(value);
+				else if (key == "C")
+					job->C = stof(value);
+				else if (key == "seed")
+					job->seed = stoul(value);
+				else
+					throw invalid_argument("unknown option " + key);
+			}
+			if (find(begin(SERVICE_ALGORITHMS), end(SERVICE_ALGORITHMS), job->algorithm) == end(SERVICE_ALGORITHMS))
+				throw invalid_argument("unknown algorithm " + job->algorithm);
+			if (format != "edgelist" && format != "binary")
+				throw invalid_argument("unknown format " + format);
+		}
+		catch (const exception& e) {
+			error = e.what();
+		}
+		// Requests that can't run are refused before their payload is read, it is skipped without storing it
+		if (!error.empty()) {
+			if (!client.writeAll("ERROR " + error + "\n") || !client.skip(bytes))
+				break;
+			continue;
+		}
+		// The payload waits in the socket until there is a slot, so at most maxActive payloads are in memory
+		if (!admit()) {
+			if (!client.writeAll("ERROR busy\n") || !client.skip(bytes))
+				break;
+			continue;
+		}
+
+		string payload(bytes, '\0');
+		if (!client.readExact(&payload[0], bytes)) {
+			release();
+			break;
+		}
+		try {
+			job->G = parseGraph(format, payload);
+			if (job->G.Nodes().empty())
+				throw invalid_argument("empty graph");
+		}
+		catch (const exception& e) {
+			error = e.what();
+		}
+		payload = string();
+		if (!error.empty()) {
+			release();
+			if (!client.writeAll("ERROR " + error + "\n"))
+				break;
+			continue;
+		}
+
+		const vector<Node>& nodes = job->G.Nodes();
+		string names = "NODES " + to_string(nodes.size()) + "\n";
+		for (const Node& node : nodes)
+			names += node.label + "\n";
+		if (!client.writeAll(names)) {
+			release();
+			break;
+		}
+		schedule(job);
+
+		// Send replies as they come until the last one. In between, look for the client hanging up,
+		// with frames=0 nothing is written until the end that would notice it
+		bool connected = true;
+		while (true) {
+			Outbox::Message message;
+			{
+				unique_lock<mutex> lock(job->out.m);
+				if (!job->out.ready.wait_for(lock, DISCONNECT_CHECK, [&] { return !job->out.messages.empty(); })) {
+					lock.unlock();
+					if (connected && client.peerClosed()) {
+						connected = false;
+						job->cancelled = true;
+					}
+					continue;
+				}
+				message = move(job->out.messages.front());
+				job->out.messages.pop_front();
+				if (message.droppable)
+					job->out.droppable--;
+			}
+			if (connected && !client.writeAll(message.data)) {
+				connected = false;
+				job->cancelled = true;
+			}
+			if (message.last)
+				break;
+		}
+		if (!connected)
+			break;
+
+		double latency = msSince(job->received);
+		{
+			lock_guard<mutex> lock(m);
+			completed++;
+			if (latencies.size() < LATENCY_SAMPLES) {
+				latencies.push_back(latency);
+				queueTimes.push_back(job->queueMs);
+			}
+			else {
+				latencies[nextSample] = latency;
+				queueTimes[nextSample] = job->queueMs;
+			}
+			nextSample = (nextSample + 1) % LATENCY_SAMPLES;
+			cout << "Session " << id << ": " << nodes.size() << " nodes, " << job->iterations << " iterations, queue "
+				<< job->queueMs << " ms, run " << job->runMs << " ms, latency " << latency << " ms" << endl;
+		}
+	}
+	lock_guard<mutex> lock(m);
+	sessions--;
+}
+
+string Service::stats()
+{
+	lock_guard<mutex> lock(m);
+	ostringstream out;
+	out << "STATS sessions=" << sessions << " active=" << active << " queued=" << queued << " completed=" << completed
+		<< " refused=" << refused << " dropped_frames=" << droppedFrames
+		<< " latency_p50_ms=" << percentile(latencies, 0.5) << " latency_p99_ms=" << percentile(latencies, 0.99)
+		<< " queue_p50_ms=" << percentile(queueTimes, 0.5) << " queue_p99_ms=" << percentile(queueTimes, 0.99) << '\n';
+	return out.str();
+}
+
+int runService(const ServiceOptions& options)
+{
+	Socket listener;
+	try {
+		listener = options.socketPath.empty() ? Socket::listenTcp(options.port) : Socket::listenUnix(options.socketPath);
+	}
+	catch (const exception& e) {
+		cout << e.what() << endl;
+		return 1;
+	}
+	cout << "Layout service on " << (options.socketPath.empty() ? "127.0.0.1:" + to_string(options.port) : options.socketPath)
+		<< ", " << ThreadPool::global().size() << " threads, " << options.maxActive << " layouts at a time" << endl;
+
+	// Lives as long as the process, sessions are detached threads, at most options.maxSessions of them
+	static Service service(options);
+	for (int id = 1; ; ++id) {
+		Socket client = listener.accept();
+		if (!client.valid()) {
+			cout << "Accepting connections failed" << endl;
+			return 1;
+		}
+		if (!service.openSession()) {
+			client.writeAll("ERROR too many sessions\n");
+			continue;
+		}
+		thread(&Service::session, &service, move(client), id).detach();
+	}
+}
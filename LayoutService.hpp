@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+using namespace std;
+
+struct ServiceOptions {
+	// Unix domain socket to listen on, or TCP port on 127.0.0.1 when empty
+	string socketPath;
+	int port = 7473;
+	// open connections, more are refused with 'ERROR too many sessions' and closed
+	int maxSessions = 64;
+	// layouts computed at the same time, more wait in a queue
+	int maxActive = 8;
+	// requests waiting for a slot, more are refused with 'ERROR busy'
+	int maxQueued = 64;
+	// per request limits, the layout reached by then is returned
+	int maxIterations = 10000;
+	int budgetMs = 30000;
+	// time a layout runs before it goes to the back of the run queue
+	int sliceMs = 20;
+	// intermediate frames waiting to be sent, the oldest one is dropped for a slow client
+	int frameQueue = 4;
+	// default parameter C of the algorithms
+	float C = 0.7f;
+};
+
+/* Layout service
+*
+* Clients connect over a Unix domain socket or localhost TCP, every connection is a session that sends
+* requests one after the other. A request waits for a layout slot before its payload is read, and a session
+* watches for its client hanging up while the layout runs, which cancels it. Layouts of all sessions run in time slices on the global thread pool,
+* round robin, so large graphs don't hold up small ones.
+*
+* Requests are text lines, replies are text lines, some followed by binary data (little endian):
+*   LAYOUT edgelist <bytes> [algorithm=fr|linlog|fa2|sgd|tree|radial|layered|auto] [iterations=N] [frames=K] [C=value] [seed=N]
+*       followed by <bytes> of '<source> <target> [weight]' lines
+*   LAYOUT binary <bytes> [...]
+*       followed by int32 n, int32 m and m times int32 source, int32 target, float32 weight
+*   -> NODES <n>                        then n lines with the node labels, in the order of the positions
+*   -> FRAME <iteration> <n>            then n pairs of float32 x, y, every K iterations and once at the end
+*   -> DONE <iterations> <converged 0|1> <queue ms> <run ms>
+*   -> ERROR <message>                  instead, the session stays open
+*   STATS
+*   -> STATS sessions=.. active=.. queued=.. completed=.. refused=.. dropped_frames=..
+*            latency_p50_ms=.. latency_p99_ms=.. queue_p50_ms=.. queue_p99_ms=..
+*   QUIT
+*
+* Latency is measured from receiving the request line to the last frame, queue time from then until the
+* first time slice. A client reading frames too slowly gets only the newest ones, the layout doesn't wait.
+*/
+int runService(const ServiceOptions& options);
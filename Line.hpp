@@ -41,4 +41,18 @@ private:
 	Vertex vertices[4];
 	float thickness;
 	Color color;
-};
\ No newline at end of file
+};
+// Append the quad sfLine would draw to a Quads vertex array, so many lines go out in one draw call
+inline void appendLine(VertexArray& out, const Vector2f& point1, const Vector2f& point2, float thickness, Color color = LINE_COLOR)
+{
+	Vector2f direction = point2 - point1;
+	float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+	if (length == 0.f)
+		return;
+	Vector2f offset = Vector2f(-direction.y, direction.x) * (thickness / 2.f / length);
+
+	out.append(Vertex(point1 + offset, color));
+	out.append(Vertex(point2 + offset, color));
+	out.append(Vertex(point2 - offset, color));
+	out.append(Vertex(point1 - offset, color));
+}
@@ -0,0 +1,264 @@
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <limits>
+
+#include "Metrics.hpp"
+#include "StressLayout.hpp"
+#include "SpatialGrid.hpp"
+#include "Parallel.hpp"
+
+const double METRICS_PI = 3.14159265358979323846;
+
+// Sorted neighbours of every node without self loops and parallel edges
+static vector<vector<int>> simpleNeighbours(const vector<list<int>>& adjList) {
+	vector<vector<int>> neighbours(adjList.size());
+	for (int u = 0; u < adjList.size(); ++u) {
+		for (int v : adjList[u]) {
+			if (v != u)
+				neighbours[u].push_back(v);
+		}
+		sort(neighbours[u].begin(), neighbours[u].end());
+		neighbours[u].erase(unique(neighbours[u].begin(), neighbours[u].end()), neighbours[u].end());
+	}
+	return neighbours;
+}
+
+static double cross(double ax, double ay, double bx, double by) {
+	return ax * by - ay * bx;
+}
+
+// Uniform grid the edges are walked through
+struct EdgeGrid {
+	double ox, oy, cell;
+	int cols, rows;
+
+	int cellX(double x) const { return min(max(int((x - ox) / cell), 0), cols - 1); }
+	int cellY(double y) const { return min(max(int((y - oy) / cell), 0), rows - 1); }
+
+	// Call f(cell) for every cell the segment a-b passes through (Amanatides-Woo)
+	template<typename F>
+	void walk(Vector2f a, Vector2f b, F&& f) const {
+		int cx = cellX(a.x), cy = cellY(a.y);
+		int ex = cellX(b.x), ey = cellY(b.y);
+		double dx = double(b.x) - a.x, dy = double(b.y) - a.y;
+		int stepX = dx > 0 ? 1 : -1, stepY = dy > 0 ? 1 : -1;
+		const double inf = numeric_limits<double>::infinity();
+		double tMaxX = dx != 0 ? ((cx + (dx > 0)) * cell + ox - a.x) / dx : inf;
+		double tMaxY = dy != 0 ? ((cy + (dy > 0)) * cell + oy - a.y) / dy : inf;
+		double tDeltaX = dx != 0 ? cell / abs(dx) : inf;
+		double tDeltaY = dy != 0 ? cell / abs(dy) : inf;
+		// the number of steps is fixed, so rounding can't make the walk run past the end cell
+		int steps = abs(ex - cx) + abs(ey - cy);
+		f(cy * cols + cx);
+		for (int s = 0; s < steps; ++s) {
+			if ((tMaxX < tMaxY && cx != ex) || cy == ey) {
+				cx += stepX;
+				tMaxX += tDeltaX;
+			}
+			else {
+				cy += stepY;
+				tMaxY += tDeltaY;
+			}
+			f(cy * cols + cx);
+		}
+	}
+};
+
+long long countCrossings(const vector<list<int>>& adjList, const vector<Vector2f>& positions)
+{
+	vector<Vector2i> edges;
+	vector<vector<int>> neighbours = simpleNeighbours(adjList);
+	for (int u = 0; u < neighbours.size(); ++u) {
+		for (int v : neighbours[u]) {
+			if (u < v)
+				edges.push_back({ u, v });
+		}
+	}
+	int m = edges.size();
+	if (m < 2)
+		return 0;
+
+	Vector2f lo = positions[0], hi = positions[0];
+	for (const Vector2f& p : positions) {
+		lo = { min(lo.x, p.x), min(lo.y, p.y) };
+		hi = { max(hi.x, p.x), max(hi.y, p.y) };
+	}
+	double w = max(double(hi.x) - lo.x, 1e-3), h = max(double(hi.y) - lo.y, 1e-3);
+	// about one cell per edge
+	double cell = sqrt(w * h / m);
+	cell = max(cell, max(w, h) / 4096.);
+	EdgeGrid grid{ lo.x, lo.y, cell, int(w / cell) + 1, int(h / cell) + 1 };
+	int cells = grid.cols * grid.rows;
+
+	// Edges of cell c are cellEdges[cellStart[c]] .. cellEdges[cellStart[c+1]-1]
+	vector<int> cellStart(cells + 1, 0);
+	for (const Vector2i& e : edges)
+		grid.walk(positions[e.x], positions[e.y], [&](int c) { cellStart[c + 1]++; });
+	partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+	vector<int> cellEdges(cellStart[cells]);
+	vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	for (int k = 0; k < m; ++k)
+		grid.walk(positions[edges[k].x], positions[edges[k].y], [&](int c) { cellEdges[fill[c]++] = k; });
+
+	vector<long long> perCell(cells, 0);
+	parallelFor(0, cells, [&](int c) {
+		long long count = 0;
+		for (int i = cellStart[c]; i < cellStart[c + 1]; ++i) {
+			const Vector2i& e = edges[cellEdges[i]];
+			Vector2f a = positions[e.x], b = positions[e.y];
+			double abx = double(b.x) - a.x, aby = double(b.y) - a.y;
+			for (int j = i + 1; j < cellStart[c + 1]; ++j) {
+				const Vector2i& f = edges[cellEdges[j]];
+				if (f.x == e.x || f.x == e.y || f.y == e.x || f.y == e.y)
+					continue;
+				Vector2f p = positions[f.x], q = positions[f.y];
+				double pqx = double(q.x) - p.x, pqy = double(q.y) - p.y;
+				// a proper crossing has the ends of each edge strictly on both sides of the other one
+				double o1 = cross(abx, aby, p.x - a.x, p.y - a.y);
+				double o2 = cross(abx, aby, q.x - a.x, q.y - a.y);
+				double o3 = cross(pqx, pqy, a.x - p.x, a.y - p.y);
+				double o4 = cross(pqx, pqy, b.x - p.x, b.y - p.y);
+				if (!((o1 > 0) != (o2 > 0) && o1 != 0 && o2 != 0 && (o3 > 0) != (o4 > 0) && o3 != 0 && o4 != 0))
+					continue;
+				// count it only in the cell containing the crossing point
+				double t = o3 / (o3 - o4);
+				if (grid.cellY(a.y + t * aby) * grid.cols + grid.cellX(a.x + t * abx) == c)
+					count++;
+			}
+		}
+		perCell[c] = count;
+	});
+
+	return accumulate(perCell.begin(), perCell.end(), 0LL);
+}
+
+// Mean Jaccard similarity of graph neighbours and the same number of nearest nodes in the layout
+static double neighbourhoodPreservation(const vector<vector<int>>& neighbours, const vector<Vector2f>& positions, const vector<int>& sampled)
+{
+	int n = positions.size();
+	Vector2f lo = positions[0], hi = positions[0];
+	for (const Vector2f& p : positions) {
+		lo = { min(lo.x, p.x), min(lo.y, p.y) };
+		hi = { max(hi.x, p.x), max(hi.y, p.y) };
+	}
+	float extent = max(max(hi.x - lo.x, hi.y - lo.y), 1e-3f);
+	float cellSize = max(extent / sqrt((float)n), 1e-3f);
+	SpatialGrid grid;
+	grid.build(positions, cellSize);
+
+	vector<double> score(sampled.size(), -1.);
+	parallelFor(0, (int)sampled.size(), [&](int s) {
+		int i = sampled[s];
+		int k = neighbours[i].size();
+		if (k == 0)
+			return;
+
+		// Grow the search radius until it holds k other nodes
+		vector<pair<float, int>> found;
+		for (float r = cellSize; ; r *= 2) {
+			found.clear();
+			grid.forEachInRadius(positions[i], r, [&](int j) {
+				if (j == i)
+					return;
+				Vector2f d = positions[j] - positions[i];
+				found.push_back({ d.x * d.x + d.y * d.y, j });
+			});
+			if (found.size() >= k || r > 2 * extent)
+				break;
+		}
+		int take = min(k, (int)found.size());
+		nth_element(found.begin(), found.begin() + take, found.end());
+		vector<int> nearest(take);
+		for (int t = 0; t < take; ++t)
+			nearest[t] = found[t].second;
+		sort(nearest.begin(), nearest.end());
+
+		vector<int> common;
+		set_intersection(nearest.begin(), nearest.end(), neighbours[i].begin(), neighbours[i].end(), back_inserter(common));
+		score[s] = double(common.size()) / (k + take - common.size());
+	});
+
+	double sum = 0.;
+	int count = 0;
+	for (double v : score) {
+		if (v >= 0.) {
+			sum += v;
+			count++;
+		}
+	}
+	return count ? sum / count : 0.;
+}
+
+LayoutMetrics layoutMetrics(const vector<list<int>>& adjList, const vector<Vector2f>& positions, int exactUpTo, int samples, unsigned seed)
+{
+	LayoutMetrics metrics;
+	int n = adjList.size();
+	if (n == 0)
+		return metrics;
+	vector<vector<int>> neighbours = simpleNeighbours(adjList);
+
+	metrics.crossings = countCrossings(adjList, positions);
+	metrics.stress = normalizedStress(adjList, positions, exactUpTo, samples, seed);
+
+	vector<int> sampled;
+	if (n <= exactUpTo) {
+		sampled.resize(n);
+		iota(sampled.begin(), sampled.end(), 0);
+	}
+	else {
+		mt19937 rng(seed);
+		for (int s = 0; s < 10 * samples; ++s)
+			sampled.push_back(uniform_int_distribution<int>(0, n - 1)(rng));
+	}
+	metrics.neighbourhood = neighbourhoodPreservation(neighbours, positions, sampled);
+
+	// Angular resolution and edge lengths, per node sums added in order afterwards
+	vector<double> angle(n, -1.), lengthSum(n, 0.), lengthSquares(n, 0.);
+	vector<int> lengthCount(n, 0);
+	parallelFor(0, n, [&](int u) {
+		const vector<int>& adj = neighbours[u];
+		for (int v : adj) {
+			if (v < u)
+				continue;
+			Vector2f d = positions[v] - positions[u];
+			double l = sqrt(double(d.x) * d.x + double(d.y) * d.y);
+			lengthSum[u] += l;
+			lengthSquares[u] += l * l;
+			lengthCount[u]++;
+		}
+		if (adj.size() < 2)
+			return;
+		vector<double> directions;
+		for (int v : adj) {
+			Vector2f d = positions[v] - positions[u];
+			directions.push_back(atan2(d.y, d.x));
+		}
+		sort(directions.begin(), directions.end());
+		double smallest = directions.front() + 2 * METRICS_PI - directions.back();
+		for (int k = 1; k < directions.size(); ++k)
+			smallest = min(smallest, directions[k] - directions[k - 1]);
+		angle[u] = smallest / (2 * METRICS_PI / adj.size());
+	});
+
+	double angleSum = 0., sum = 0., squares = 0.;
+	int angleCount = 0;
+	long long m = 0;
+	for (int u = 0; u < n; ++u) {
+		if (angle[u] >= 0.) {
+			angleSum += angle[u];
+			angleCount++;
+		}
+		sum += lengthSum[u];
+		squares += lengthSquares[u];
+		m += lengthCount[u];
+	}
+	metrics.angularResolution = angleCount ? angleSum / angleCount : 0.;
+	if (m > 0 && sum > 0.) {
+		double mean = sum / m;
+		metrics.edgeLengthVariance = max(squares / m - mean * mean, 0.) / (mean * mean);
+	}
+
+	return metrics;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <SFML/System/Vector2.hpp>
+
+using namespace std;
+using namespace sf;
+
+// Quality of a layout, for comparing algorithms and settings
+struct LayoutMetrics {
+	// pairs of edges that cross, edges sharing a node don't count
+	long long crossings = 0;
+	// normalized stress, see normalizedStress(), lower is better
+	double stress = 0.;
+	// mean Jaccard similarity of graph neighbours and as many nearest nodes in the layout, 1 is best
+	double neighbourhood = 0.;
+	// mean smallest angle between edges of a node relative to the ideal 2pi / degree, 1 is best
+	double angularResolution = 0.;
+	// variance of edge lengths divided by squared mean length, 0 is best
+	double edgeLengthVariance = 0.;
+};
+
+/* Number of edge crossings
+*
+* Edges are walked through a uniform grid of about one cell per edge, only edges sharing a cell are tested
+* and every crossing is counted in the cell that contains it. Cells are processed in parallel.
+*/
+long long countCrossings(const vector<list<int>>& adjList, const vector<Vector2f>& positions);
+
+// All metrics of a layout. Stress and neighbourhood preservation are exact for graphs up to 'exactUpTo' nodes,
+// otherwise estimated from 'samples' BFS sources and 10 times as many sampled nodes
+LayoutMetrics layoutMetrics(const vector<list<int>>& adjList, const vector<Vector2f>& positions,
+	int exactUpTo = 3000, int samples = 200, unsigned seed = 0);
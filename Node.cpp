@@ -6,6 +6,6 @@ int Node::id_gen = 0;
 
 
 std::ostream& operator<<(std::ostream& os, const Node& obj) {
-	os << "(id=" << obj.id << ", pos=(" << obj.pos.x << "," << obj.pos.y << "))";
+	os << "(id=" << obj.id << ", pos=(" << obj.shape.getPosition().x << "," << obj.shape.getPosition().y << "))";
 	return os;
  }
\ No newline at end of file
@@ -17,7 +17,6 @@ class Node {
 	static int id_gen;
 
 public:
-	Vector2f pos;
 	int id;
 	string label;
 	CircleShape shape;
@@ -29,11 +28,11 @@ public:
 
 
 	Node(float posX, float posY, float r = DEFAULT_RADIUS)
-		: id(this->id_gen++), pos(Vector2f(posX, posY))
+		: id(this->id_gen++)
 	{
 		shape = CircleShape(r);
 		shape.setOrigin(r, r);
-		shape.setPosition(this->pos);
+		shape.setPosition(posX, posY);
 	}
 
 	 static Node from_id(int id, string label = "", float r = DEFAULT_RADIUS) {
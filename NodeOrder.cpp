@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "NodeOrder.hpp"
+
+// Hilbert curve resolution, 2^HILBERT_BITS cells per side
+const int HILBERT_BITS = 16;
+// Sweeps looking for a node further from the start of a component
+const int PERIPHERAL_SWEEPS = 4;
+
+// BFS from 'start' over nodes not yet 'placed', neighbours in increasing degree order, appended to 'order'
+// Returns the number of BFS levels, 'lastLevel' is set to the index in 'order' where the last one starts
+static int cuthillMcKee(const vector<list<int>>& adjList, int start, vector<char>& placed, vector<int>& order, size_t& lastLevel)
+{
+	vector<int> next;
+	lastLevel = order.size();
+	order.push_back(start);
+	placed[start] = true;
+	int levels = 1;
+	for (size_t head = lastLevel, levelEnd = order.size(); head < order.size(); ++head) {
+		if (head == levelEnd) {
+			lastLevel = head;
+			levelEnd = order.size();
+			levels++;
+		}
+		next.clear();
+		for (int v : adjList[order[head]]) {
+			if (!placed[v]) {
+				placed[v] = true;
+				next.push_back(v);
+			}
+		}
+		sort(next.begin(), next.end(), [&](int a, int b) { return adjList[a].size() < adjList[b].size(); });
+		order.insert(order.end(), next.begin(), next.end());
+	}
+	return levels;
+}
+
+vector<int> reverseCuthillMcKee(const vector<list<int>>& adjList)
+{
+	int n = adjList.size();
+	vector<int> byDegree(n);
+	for (int i = 0; i < n; ++i)
+		byDegree[i] = i;
+	stable_sort(byDegree.begin(), byDegree.end(), [&](int a, int b) { return adjList[a].size() < adjList[b].size(); });
+
+	vector<int> order, component;
+	order.reserve(n);
+	vector<char> placed(n, false), probe(n, false);
+	size_t lastLevel;
+	for (int s : byDegree) {
+		if (placed[s])
+			continue;
+		// Pseudo-peripheral start (George & Liu): move to a low degree node of the last level while the BFS gets deeper
+		int start = s, depth = 0;
+		for (int sweep = 0; sweep < PERIPHERAL_SWEEPS; ++sweep) {
+			component.clear();
+			int levels = cuthillMcKee(adjList, start, probe, component, lastLevel);
+			for (int v : component)
+				probe[v] = false;
+			if (levels <= depth)
+				break;
+			depth = levels;
+			start = *min_element(component.begin() + lastLevel, component.end(),
+				[&](int a, int b) { return adjList[a].size() < adjList[b].size(); });
+		}
+		cuthillMcKee(adjList, start, placed, order, lastLevel);
+	}
+	reverse(order.begin(), order.end());
+	return order;
+}
+
+// Position of cell (x, y) along the Hilbert curve
+static uint64_t hilbertIndex(uint32_t x, uint32_t y)
+{
+	uint64_t d = 0;
+	for (uint32_t s = 1u << (HILBERT_BITS - 1); s > 0; s /= 2) {
+		uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+		d += uint64_t(s) * s * ((3 * rx) ^ ry);
+		// rotate the quadrant
+		if (ry == 0) {
+			if (rx == 1) {
+				x = s - 1 - x;
+				y = s - 1 - y;
+			}
+			swap(x, y);
+		}
+	}
+	return d;
+}
+
+vector<int> hilbertOrder(const vector<Vector2f>& positions)
+{
+	int n = positions.size();
+	if (n == 0)
+		return {};
+	Vector2f lo = positions[0], hi = positions[0];
+	for (const Vector2f& p : positions) {
+		lo = { min(lo.x, p.x), min(lo.y, p.y) };
+		hi = { max(hi.x, p.x), max(hi.y, p.y) };
+	}
+	float cells = float((1u << HILBERT_BITS) - 1);
+	float scale = cells / max(max(hi.x - lo.x, hi.y - lo.y), 1e-6f);
+
+	vector<pair<uint64_t, int>> keys(n);
+	for (int i = 0; i < n; ++i) {
+		uint32_t x = (uint32_t)min((positions[i].x - lo.x) * scale, cells);
+		uint32_t y = (uint32_t)min((positions[i].y - lo.y) * scale, cells);
+		keys[i] = { hilbertIndex(x, y), i };
+	}
+	sort(keys.begin(), keys.end());
+	vector<int> order(n);
+	for (int k = 0; k < n; ++k)
+		order[k] = keys[k].second;
+	return order;
+}
+
+double edgeSpan(const vector<list<int>>& adjList)
+{
+	double total = 0.;
+	long long count = 0;
+	for (int i = 0; i < adjList.size(); ++i) {
+		for (int j : adjList[i]) {
+			total += abs(i - j);
+			count++;
+		}
+	}
+	return count ? total / count : 0.;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <SFML/System/Vector2.hpp>
+
+using namespace std;
+using namespace sf;
+
+/* Node orders for memory locality
+*
+* Both return a permutation 'order', order[k] being the node that goes to index k, so nodes used together
+* end up close in memory and layout kernels walking edges touch fewer cache lines.
+*/
+
+// Reverse Cuthill-McKee: BFS from a pseudo-peripheral node of every component, neighbours by increasing degree,
+// the whole order reversed. Keeps neighbours close in index, for any layout.
+vector<int> reverseCuthillMcKee(const vector<list<int>>& adjList);
+
+// Nodes sorted along a Hilbert curve through the bounding box of the positions, so nodes close on the canvas
+// are close in memory. Neighbours end up close once the layout has started to converge.
+vector<int> hilbertOrder(const vector<Vector2f>& positions);
+
+// Mean index distance |i - j| of the edges, lower is better locality
+double edgeSpan(const vector<list<int>>& adjList);
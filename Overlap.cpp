@@ -0,0 +1,72 @@
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+#include "Overlap.hpp"
+#include "SpatialGrid.hpp"
+#include "Parallel.hpp"
+
+int removeOverlaps(vector<Vector2f>& centers, const vector<float>& radii, const vector<bool>& pinned,
+	FloatRect area, bool horizontal, float gap, int maxPasses)
+{
+	int n = centers.size();
+	if (n < 2)
+		return 0;
+	float maxRadius = *max_element(radii.begin(), radii.end());
+
+	SpatialGrid grid;
+	vector<Vector2f> moves(n);
+	vector<int> overlaps(n);
+	int remaining = 0;
+	for (int pass = 0; ; ++pass) {
+		grid.build(centers, 2 * maxRadius + gap);
+
+		// Every node sums its own moves, both nodes of a pair see it, so there are no write conflicts
+		parallelFor(0, n, [&](int i) {
+			Vector2f move = { 0, 0 };
+			int count = 0;
+			grid.forEachInRadius(centers[i], radii[i] + maxRadius + gap, [&](int j) {
+				if (j == i)
+					return;
+				Vector2f d = centers[i] - centers[j];
+				float dist = sqrt(d.x * d.x + d.y * d.y);
+				float reach = radii[i] + radii[j] + gap;
+				float overlap = reach - dist;
+				if (overlap <= 0.f)
+					return;
+				count++;
+				if (pinned[i])
+					return;
+				Vector2f dir;
+				if (horizontal) {
+					// Distance along x at which the circles clear each other at their vertical offset
+					overlap = sqrt(reach * reach - d.y * d.y) - abs(d.x);
+					float side = d.x != 0.f ? d.x : float(i - j);
+					dir = { side > 0.f ? 1.f : -1.f, 0.f };
+				}
+				else if (dist > 1e-4f)
+					dir = d / dist;
+				else {
+					// Same spot, split the pair in a direction fixed by the indices
+					float angle = (min(i, j) * 0.618034f + max(i, j) * 0.381966f) * 6.2831853f;
+					dir = Vector2f(cos(angle), sin(angle)) * (i < j ? 1.f : -1.f);
+				}
+				move += dir * (pinned[j] ? overlap : overlap / 2);
+			});
+			moves[i] = move;
+			overlaps[i] = count;
+		}, 256);
+
+		remaining = accumulate(overlaps.begin(), overlaps.end(), 0) / 2;
+		if (remaining == 0 || pass == maxPasses)
+			break;
+		for (int i = 0; i < n; ++i) {
+			if (pinned[i])
+				continue;
+			centers[i] += moves[i];
+			centers[i].x = min(max(centers[i].x, area.left + radii[i]), area.left + area.width - radii[i]);
+			centers[i].y = min(max(centers[i].y, area.top + radii[i]), area.top + area.height - radii[i]);
+		}
+	}
+	return remaining;
+}
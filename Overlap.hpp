@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+
+using namespace std;
+using namespace sf;
+
+/* Node overlap removal
+*
+* Circles that overlap (closer than the sum of their radii plus 'gap') are pushed apart along the line
+* through their centers, each by half of the overlap, or all of it if the other one is pinned.
+* Moving along that line keeps the pair's relative order and moves nodes no further than needed.
+* With 'horizontal' nodes only move along x, just far enough to clear each other, so rows stay rows.
+* Every pass keeps the circles inside 'area', a node stopped by the border leaves the rest to the other one.
+* Overlapping pairs are found with a uniform grid, so a pass is O(n) for evenly sized nodes,
+* passes repeat until nothing overlaps or 'maxPasses' is reached. Nodes are handled in parallel.
+* Returns the number of overlapping pairs left.
+*/
+int removeOverlaps(vector<Vector2f>& centers, const vector<float>& radii, const vector<bool>& pinned,
+	FloatRect area, bool horizontal = false, float gap = 1.f, int maxPasses = 50);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// Number of threads used by parallel kernels
+inline int numWorkers() {
+	int n = (int)std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+#include "ThreadPool.hpp"
+
+// Call f(i) for every i in [begin, end), split into contiguous chunks run on the global thread pool.
+// Each index is visited exactly once, so f may write to slot i of a shared array without locking.
+// Safe to call from inside a pool task, the caller runs chunks itself while it waits.
+template<typename F>
+void parallelFor(int begin, int end, F&& f, int minChunk = 64) {
+	int count = end - begin;
+	if (count <= 0)
+		return;
+
+	ThreadPool& pool = ThreadPool::global();
+	int workers = std::min(pool.size() + 1, (count + minChunk - 1) / minChunk);
+	if (workers <= 1) {
+		for (int i = begin; i < end; ++i)
+			f(i);
+		return;
+	}
+
+	int chunk = (count + workers - 1) / workers;
+	TaskGroup group(pool);
+	for (int w = 1; w < workers; ++w) {
+		int from = begin + w * chunk;
+		int to = std::min(end, from + chunk);
+		group.run([from, to, &f]() {
+			for (int i = from; i < to; ++i)
+				f(i);
+		});
+	}
+	// Calling thread takes the first chunk
+	for (int i = begin; i < std::min(end, begin + chunk); ++i)
+		f(i);
+
+	group.wait();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <random>
+
+using namespace std;
+
+/* Philox4x32-10 counter based random numbers (Salmon et al., 2011)
+*
+* Every block of four numbers is a function of the key and a counter only, so numbers for node i can be
+* computed on any thread in any order and a layout is the same for the same seed whatever the thread count.
+*/
+namespace Philox {
+	using Block = array<uint32_t, 4>;
+
+	inline Block generate(Block counter, uint64_t key) {
+		const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+		const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+		uint32_t k0 = uint32_t(key), k1 = uint32_t(key >> 32);
+		Block c = counter;
+		for (int round = 0; round < 10; ++round) {
+			uint64_t p0 = uint64_t(M0) * c[0];
+			uint64_t p1 = uint64_t(M1) * c[2];
+			c = { uint32_t(p1 >> 32) ^ c[1] ^ k0, uint32_t(p1), uint32_t(p0 >> 32) ^ c[3] ^ k1, uint32_t(p0) };
+			k0 += W0;
+			k1 += W1;
+		}
+		return c;
+	}
+}
+
+// Four uniform numbers in [0, 1) for item 'index' of a 'stream', different uses of the same seed take different streams
+inline array<float, 4> uniform4(uint64_t seed, uint64_t index, uint32_t stream = 0) {
+	Philox::Block bits = Philox::generate({ uint32_t(index), uint32_t(index >> 32), stream, 0 }, seed);
+	array<float, 4> u;
+	for (int k = 0; k < 4; ++k)
+		u[k] = (bits[k] >> 8) * (1.f / 16777216.f);
+	return u;
+}
+
+// A fresh seed, for when the user didn't pick one
+inline unsigned randomSeed() {
+	return random_device()();
+}
@@ -0,0 +1,226 @@
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+
+#include "Socket.hpp"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#endif
+
+// Bytes read from the connection at a time
+const size_t READ_CHUNK = 64 * 1024;
+// Connections waiting to be accepted
+const int LISTEN_BACKLOG = 128;
+
+#ifdef _WIN32
+static void startup() {
+	static bool started = false;
+	if (!started) {
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+			throw runtime_error("WSAStartup failed");
+		started = true;
+	}
+}
+static void closeHandle(Socket::Handle h) { closesocket((SOCKET)h); }
+#else
+static void startup() {
+	// A client going away must show up as a failed write, not kill the process
+	signal(SIGPIPE, SIG_IGN);
+}
+static void closeHandle(Socket::Handle h) { ::close(h); }
+#endif
+
+Socket::Handle Socket::invalidHandle()
+{
+#ifdef _WIN32
+	return (Handle)INVALID_SOCKET;
+#else
+	return -1;
+#endif
+}
+
+Socket::Socket(Socket&& other) noexcept
+	: handle(other.handle), buffer(move(other.buffer)), bufferPos(other.bufferPos)
+{
+	other.handle = invalidHandle();
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	if (this != &other) {
+		close();
+		handle = other.handle;
+		buffer = move(other.buffer);
+		bufferPos = other.bufferPos;
+		other.handle = invalidHandle();
+	}
+	return *this;
+}
+
+bool Socket::valid() const
+{
+	return handle != invalidHandle();
+}
+
+void Socket::close()
+{
+	if (valid()) {
+		closeHandle(handle);
+		handle = invalidHandle();
+	}
+}
+
+Socket Socket::listenUnix(const string& path)
+{
+	startup();
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+		throw runtime_error("Socket path too long: " + path);
+	strcpy(address.sun_path, path.c_str());
+	remove(path.c_str());
+
+	Socket s((Handle)::socket(AF_UNIX, SOCK_STREAM, 0));
+	if (!s.valid())
+		throw runtime_error("Can't create socket");
+	if (::bind(s.handle, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(s.handle, LISTEN_BACKLOG) != 0)
+		throw runtime_error("Can't listen on " + path);
+	return s;
+}
+
+Socket Socket::listenTcp(int port)
+{
+	startup();
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)port);
+	// Local clients only, the service has no authentication
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	Socket s((Handle)::socket(AF_INET, SOCK_STREAM, 0));
+	if (!s.valid())
+		throw runtime_error("Can't create socket");
+	int reuse = 1;
+	setsockopt(s.handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+	if (::bind(s.handle, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(s.handle, LISTEN_BACKLOG) != 0)
+		throw runtime_error("Can't listen on 127.0.0.1:" + to_string(port));
+	return s;
+}
+
+Socket Socket::accept()
+{
+	Socket client((Handle)::accept(handle, nullptr, nullptr));
+	if (client.valid()) {
+		// Frames are written in one piece, don't hold them back
+		int noDelay = 1;
+		setsockopt(client.handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+	}
+	return client;
+}
+
+bool Socket::fill()
+{
+	if (bufferPos == buffer.size()) {
+		buffer.clear();
+		bufferPos = 0;
+	}
+	size_t old = buffer.size();
+	buffer.resize(old + READ_CHUNK);
+	auto got = ::recv(handle, &buffer[old], (int)READ_CHUNK, 0);
+	buffer.resize(old + (got > 0 ? got : 0));
+	return got > 0;
+}
+
+bool Socket::readLine(string& line, size_t maxLength)
+{
+	line.clear();
+	while (true) {
+		size_t end = buffer.find('\n', bufferPos);
+		if (end != string::npos) {
+			line.append(buffer, bufferPos, end - bufferPos);
+			bufferPos = end + 1;
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			return true;
+		}
+		line.append(buffer, bufferPos, string::npos);
+		bufferPos = buffer.size();
+		if (line.size() > maxLength || !fill())
+			return false;
+	}
+}
+
+bool Socket::readExact(void* data, size_t size)
+{
+	char* out = (char*)data;
+	while (size > 0) {
+		if (bufferPos == buffer.size() && !fill())
+			return false;
+		size_t take = min(size, buffer.size() - bufferPos);
+		memcpy(out, buffer.data() + bufferPos, take);
+		bufferPos += take;
+		out += take;
+		size -= take;
+	}
+	return true;
+}
+
+bool Socket::skip(size_t size)
+{
+	while (size > 0) {
+		if (bufferPos == buffer.size() && !fill())
+			return false;
+		size_t take = min(size, buffer.size() - bufferPos);
+		bufferPos += take;
+		size -= take;
+	}
+	return true;
+}
+
+bool Socket::peerClosed()
+{
+	// Unread data, the client is still talking
+	if (bufferPos < buffer.size())
+		return false;
+#ifdef _WIN32
+	WSAPOLLFD p = { (SOCKET)handle, POLLRDNORM, 0 };
+	if (WSAPoll(&p, 1, 0) <= 0)
+		return false;
+#else
+	pollfd p = { handle, POLLIN, 0 };
+	if (::poll(&p, 1, 0) <= 0)
+		return false;
+#endif
+	// Readable: either data of the next request, which stays queued, or the end of the stream
+	char c;
+	return ::recv(handle, &c, 1, MSG_PEEK) <= 0;
+}
+
+bool Socket::writeAll(const void* data, size_t size)
+{
+	const char* p = (const char*)data;
+	while (size > 0) {
+		auto sent = ::send(handle, p, (int)min(size, READ_CHUNK * 16), 0);
+		if (sent <= 0)
+			return false;
+		p += sent;
+		size -= sent;
+	}
+	return true;
+}
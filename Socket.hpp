@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/* Blocking stream socket, a Unix domain socket or TCP on localhost
+*
+* Reads are buffered so a text line can be followed by binary data on the same socket.
+* Errors while listening throw runtime_error, reads and writes return false once the connection is gone.
+*/
+class Socket
+{
+public:
+#ifdef _WIN32
+	using Handle = uintptr_t;
+#else
+	using Handle = int;
+#endif
+
+	Socket() = default;
+	explicit Socket(Handle handle) : handle(handle) {}
+	~Socket() { close(); }
+	Socket(Socket&& other) noexcept;
+	Socket& operator=(Socket&& other) noexcept;
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+
+	// Listen on a Unix domain socket at 'path', an old socket file there is replaced
+	static Socket listenUnix(const string& path);
+	// Listen on 127.0.0.1:port
+	static Socket listenTcp(int port);
+	// Wait for the next connection, returns an invalid socket once the listening socket is closed
+	Socket accept();
+
+	bool valid() const;
+	// Read up to '\n', the line is returned without it
+	bool readLine(string& line, size_t maxLength = 4096);
+	bool readExact(void* data, size_t size);
+	// Read and drop 'size' bytes without buffering them all
+	bool skip(size_t size);
+	// True once the other end has closed the connection, doesn't block or consume data
+	bool peerClosed();
+	bool writeAll(const void* data, size_t size);
+	bool writeAll(const string& text) { return writeAll(text.data(), text.size()); }
+	void close();
+private:
+	Handle handle = invalidHandle();
+	string buffer;
+	size_t bufferPos = 0;
+
+	static Handle invalidHandle();
+	// Read more data into the buffer
+	bool fill();
+};
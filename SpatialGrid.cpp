@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <limits>
+
+#include "SpatialGrid.hpp"
+
+// Upper bound on cells per point, keeps memory linear when points are sparse
+const int MAX_CELLS_PER_POINT = 4;
+
+void SpatialGrid::build(const vector<Vector2f>& points, float cellSize)
+{
+	items.clear();
+	sorted.clear();
+	cellStart.clear();
+	moved.clear();
+	movedPos.clear();
+	slot.assign(points.size(), 0);
+	cols = rows = 0;
+	if (points.empty())
+		return;
+
+	Vector2f lo = points[0], hi = points[0];
+	for (const Vector2f& p : points) {
+		lo.x = min(lo.x, p.x); lo.y = min(lo.y, p.y);
+		hi.x = max(hi.x, p.x); hi.y = max(hi.y, p.y);
+	}
+
+	// Grow the cells until the grid is small enough
+	cellSize = max(cellSize, 1e-3f);
+	double maxCells = double(points.size()) * MAX_CELLS_PER_POINT + 1;
+	while (double(floor((hi.x - lo.x) / cellSize) + 1) * double(floor((hi.y - lo.y) / cellSize) + 1) > maxCells)
+		cellSize *= 2;
+
+	this->cellSize = cellSize;
+	origin = lo;
+	cols = int((hi.x - lo.x) / cellSize) + 1;
+	rows = int((hi.y - lo.y) / cellSize) + 1;
+
+	// Counting sort of points by cell
+	// The cell count changes with the extent of the points, reserve for the largest grid so rebuilds don't reallocate
+	cellStart.reserve(size_t(maxCells) + 1);
+	cellFill.reserve(size_t(maxCells));
+	cellStart.assign(size_t(cols) * rows + 1, 0);
+	cellOf.resize(points.size());
+	for (int i = 0; i < points.size(); ++i) {
+		cellOf[i] = cellY(points[i].y) * cols + cellX(points[i].x);
+		cellStart[cellOf[i] + 1]++;
+	}
+	for (int c = 0; c < cols * rows; ++c)
+		cellStart[c + 1] += cellStart[c];
+
+	items.resize(points.size());
+	sorted.resize(points.size());
+	cellFill.assign(cellStart.begin(), cellStart.end() - 1);
+	for (int i = 0; i < points.size(); ++i) {
+		int k = cellFill[cellOf[i]]++;
+		items[k] = i;
+		sorted[k] = points[i];
+		slot[i] = k;
+	}
+}
+
+void SpatialGrid::move(int i, Vector2f p)
+{
+	int s = slot[i];
+	if (s < 0) {
+		movedPos[-2 - s] = p;
+		return;
+	}
+
+	int c = cellY(p.y) * cols + cellX(p.x);
+	if (cellStart[c] <= s && s < cellStart[c + 1]) {
+		// Still in the same cell
+		sorted[s] = p;
+		return;
+	}
+
+	// NaN never passes the distance test, so the old slot is skipped by queries
+	sorted[s] = { numeric_limits<float>::quiet_NaN(), numeric_limits<float>::quiet_NaN() };
+	slot[i] = -2 - int(moved.size());
+	moved.push_back(i);
+	movedPos.push_back(p);
+}
+
+int SpatialGrid::nearest(Vector2f p, float r) const
+{
+	int best = -1;
+	float bestDist = numeric_limits<float>::max();
+	scan(p, r, [&](int i, float d2) {
+		if (d2 < bestDist) {
+			bestDist = d2;
+			best = i;
+		}
+	});
+	return best;
+}
+
+int SpatialGrid::cellX(float x) const
+{
+	return max(0, min(cols - 1, int((x - origin.x) / cellSize)));
+}
+
+int SpatialGrid::cellY(float y) const
+{
+	return max(0, min(rows - 1, int((y - origin.y) / cellSize)));
+}
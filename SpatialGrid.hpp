@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <SFML/System/Vector2.hpp>
+
+using namespace std;
+using namespace sf;
+
+/* Uniform grid over a set of points
+*
+* Points are bucketed into square cells (counting sort, O(n) build) so fixed-radius
+* neighbour queries only visit the cells overlapping the query circle.
+* Cell size should be close to the typical query radius.
+*/
+class SpatialGrid
+{
+public:
+	// Rebuild the grid over given points
+	void build(const vector<Vector2f>& points, float cellSize);
+
+	// Call f(index) for every point within distance r from p
+	template<typename F>
+	void forEachInRadius(Vector2f p, float r, F&& f) const;
+
+	// Index of the point nearest to p within distance r, -1 if there is none
+	int nearest(Vector2f p, float r) const;
+
+	// Update position of point i without rebuilding the grid.
+	// Points that leave their cell go to a small overflow list scanned by every query,
+	// call build() again once many points have moved.
+	void move(int i, Vector2f p);
+	int movedCount() const { return moved.size(); }
+
+	bool empty() const { return items.empty(); }
+private:
+	// Call f(index, squared distance) for every point within distance r from p
+	template<typename F>
+	void scan(Vector2f p, float r, F&& f) const;
+
+	int cellX(float x) const;
+	int cellY(float y) const;
+
+	float cellSize = 1.f;
+	Vector2f origin;
+	int cols = 0, rows = 0;
+	// Points of cell c are items[cellStart[c]] .. items[cellStart[c+1]-1]
+	vector<int> cellStart;
+	vector<int> items;
+	// Point positions in the same order as items, so queries scan contiguous memory
+	vector<Vector2f> sorted;
+	// Position of point i in items, or -2-k if it is moved[k]
+	vector<int> slot;
+	// Scratch of build(): cell of every point and next free slot of every cell
+	vector<int> cellOf;
+	vector<int> cellFill;
+	// Points that left their cell since the last build
+	vector<int> moved;
+	vector<Vector2f> movedPos;
+};
+
+template<typename F>
+void SpatialGrid::forEachInRadius(Vector2f p, float r, F&& f) const
+{
+	scan(p, r, [&f](int i, float) { f(i); });
+}
+
+template<typename F>
+void SpatialGrid::scan(Vector2f p, float r, F&& f) const
+{
+	if (items.empty())
+		return;
+
+	int x0 = cellX(p.x - r), x1 = cellX(p.x + r);
+	int y0 = cellY(p.y - r), y1 = cellY(p.y + r);
+	float r2 = r * r;
+	for (int cy = y0; cy <= y1; ++cy) {
+		for (int cx = x0; cx <= x1; ++cx) {
+			int c = cy * cols + cx;
+			for (int k = cellStart[c]; k < cellStart[c + 1]; ++k) {
+				float dx = sorted[k].x - p.x;
+				float dy = sorted[k].y - p.y;
+				float d2 = dx * dx + dy * dy;
+				if (d2 <= r2)
+					f(items[k], d2);
+			}
+		}
+	}
+
+	for (int k = 0; k < moved.size(); ++k) {
+		float dx = movedPos[k].x - p.x;
+		float dy = movedPos[k].y - p.y;
+		float d2 = dx * dx + dy * dy;
+		if (d2 <= r2)
+			f(moved[k], d2);
+	}
+}
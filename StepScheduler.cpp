@@ -0,0 +1,54 @@
+#include <algorithm>
+
+#include "StepScheduler.hpp"
+
+// Weight of the newest step time in the moving average
+const float STEP_TIME_SMOOTHING = 0.2f;
+// Longest stretch of time turned into steps, a stalled frame doesn't cause a burst afterwards
+const double MAX_CREDIT_SECONDS = 0.25;
+
+void StepScheduler::setTarget(float iterationsPerSecond)
+{
+	target = max(0.f, iterationsPerSecond);
+	credit = min(credit, 1.);
+}
+
+void StepScheduler::restart()
+{
+	started = false;
+	credit = 0.;
+}
+
+bool StepScheduler::run(const function<bool()>& step)
+{
+	auto frameStart = SteadyClock::now();
+	if (target > 0.f) {
+		double elapsed = started ? chrono::duration<double>(frameStart - lastFrame).count() : 0.;
+		// The first frame after a restart steps right away
+		credit = started ? credit + min(elapsed, MAX_CREDIT_SECONDS) * target : max(credit, 1.);
+	}
+	lastFrame = frameStart;
+	started = true;
+
+	steps = 0;
+	bool running = true;
+	while (running) {
+		if (target > 0.f && credit < 1.)
+			break;
+		float spent = chrono::duration<float, milli>(SteadyClock::now() - frameStart).count();
+		if (steps > 0 && spent + stepMs > budgetMs)
+			break;
+
+		auto stepStart = SteadyClock::now();
+		running = step();
+		float ms = chrono::duration<float, milli>(SteadyClock::now() - stepStart).count();
+		stepMs = stepMs == 0.f ? ms : stepMs + STEP_TIME_SMOOTHING * (ms - stepMs);
+		steps++;
+		if (target > 0.f)
+			credit -= 1.;
+	}
+	// Steps the budget couldn't fit aren't owed anymore
+	if (target > 0.f)
+		credit = min(credit, 1. + target * budgetMs / 1000.);
+	return running;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+using namespace std;
+
+/* Runs layout steps between two frames
+*
+* As many steps as fit in the frame time budget are run, so small graphs aren't held back by the frame rate
+* while a large graph still gets a fresh frame every budget. With a target rate only that many steps per second
+* are run, the rest of the frame is left to drawing and sleeping.
+* Step times are tracked as a moving average, a step that likely doesn't fit in what is left of the budget is
+* left for the next frame. At least one step runs per frame even if it alone takes longer than the budget.
+*/
+class StepScheduler
+{
+public:
+	StepScheduler(float budgetMs = 12.f) : budgetMs(budgetMs) {}
+
+	void setBudget(float budgetMs) { this->budgetMs = budgetMs; }
+	// Steps per second, 0 runs as many as fit in the budget
+	void setTarget(float iterationsPerSecond);
+	// Forget the time since the last frame, call when stepping starts again after a pause
+	void restart();
+
+	// Run 'step' until it returns false or the frame is used up, returns false once a step did
+	bool run(const function<bool()>& step);
+
+	// Steps run in the last frame
+	int Steps() const { return steps; }
+	// Moving average time of one step in ms
+	float StepTime() const { return stepMs; }
+private:
+	using SteadyClock = chrono::steady_clock;
+
+	float budgetMs;
+	float target = 0.f;
+	// Steps owed by the target rate, carried over between frames
+	double credit = 0.;
+	SteadyClock::time_point lastFrame;
+	bool started = false;
+	float stepMs = 0.f;
+	int steps = 0;
+};
@@ -0,0 +1,233 @@
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "StressLayout.hpp"
+#include "Parallel.hpp"
+
+void bfsDistances(const vector<list<int>>& adjList, int source, vector<int>& dist)
+{
+	dist.assign(adjList.size(), -1);
+	vector<int> queue = { source };
+	dist[source] = 0;
+	for (size_t head = 0; head < queue.size(); ++head) {
+		int u = queue[head];
+		for (int v : adjList[u]) {
+			if (dist[v] == -1) {
+				dist[v] = dist[u] + 1;
+				queue.push_back(v);
+			}
+		}
+	}
+}
+
+void StressLayout::init(const vector<list<int>>& adjList, float l)
+{
+	int n = adjList.size();
+	terms.clear();
+	t = 0;
+	rng.seed(params.seed);
+	vector<int> dist;
+
+	if (n <= params.sparseFrom) {
+		// All pairs, pairs in different components get their distance once the diameter is known
+		int diameter = 0;
+		for (int i = 0; i < n; ++i) {
+			bfsDistances(adjList, i, dist);
+			for (int j = i + 1; j < n; ++j) {
+				if (dist[j] > 0)
+					terms.push_back({ i, j, dist[j] * l, 1.f / (float(dist[j]) * dist[j]), false });
+				else if (dist[j] < 0)
+					terms.push_back({ i, j, -1.f, 0.f, false });
+				diameter = max(diameter, dist[j]);
+			}
+		}
+
+		// Disconnected pairs are kept one edge further apart than the farthest connected ones
+		float apart = diameter + 1.f;
+		for (Term& term : terms) {
+			if (term.d < 0) {
+				term.d = apart * l;
+				term.w = 1.f / (apart * apart);
+			}
+		}
+	}
+	else {
+		// Exact terms for edges
+		for (int i = 0; i < n; ++i) {
+			for (int j : adjList[i]) {
+				if (i < j)
+					terms.push_back({ i, j, l, 1.f, false });
+			}
+		}
+
+		// Max-min pivots: each next pivot is the node farthest from all previous ones
+		int k = min(n, params.pivots);
+		vector<int> pivots;
+		vector<vector<int>> pivotDist;
+		vector<int> nearest(n, numeric_limits<int>::max());
+		vector<int> region(n, -1);
+		int next = uniform_int_distribution<int>(0, n - 1)(rng);
+		for (int p = 0; p < k; ++p) {
+			pivots.push_back(next);
+			bfsDistances(adjList, next, dist);
+			for (int v = 0; v < n; ++v) {
+				if (dist[v] >= 0 && dist[v] < nearest[v]) {
+					nearest[v] = dist[v];
+					region[v] = p;
+				}
+			}
+			pivotDist.push_back(dist);
+			next = max_element(nearest.begin(), nearest.end()) - nearest.begin();
+		}
+
+		// Distances from each pivot to the members of its region, sorted
+		vector<vector<int>> regionDist(k);
+		for (int v = 0; v < n; ++v) {
+			if (region[v] >= 0)
+				regionDist[region[v]].push_back(nearest[v]);
+		}
+		for (auto& r : regionDist)
+			sort(r.begin(), r.end());
+
+		// Nodes a pivot can't reach are kept one edge further apart than the farthest ones it reaches
+		float apart = 1.f;
+		for (const auto& dists : pivotDist)
+			apart = max(apart, *max_element(dists.begin(), dists.end()) + 1.f);
+
+		for (int p = 0; p < k; ++p) {
+			for (int i = 0; i < n; ++i) {
+				int d = pivotDist[p][i];
+				if (d < 0) {
+					terms.push_back({ i, pivots[p], apart * l, regionDist[p].size() / (apart * apart), true });
+					continue;
+				}
+				// neighbours already have an exact term
+				if (d <= 1)
+					continue;
+				// pivot stands for the members of its region closer to it than half the distance to i
+				int s = upper_bound(regionDist[p].begin(), regionDist[p].end(), d / 2) - regionDist[p].begin();
+				terms.push_back({ i, pivots[p], d * l, max(1, s) / (float(d) * d), true });
+			}
+		}
+	}
+
+	// Annealing schedule eta_t = etaMax * e^(-lambda t), from 1/w_min down to eps/w_max
+	float wMin = numeric_limits<float>::max(), wMax = 0.f;
+	for (const Term& term : terms) {
+		wMin = min(wMin, term.w);
+		wMax = max(wMax, term.w);
+	}
+	if (terms.empty())
+		return;
+	etaMax = 1.f / wMin;
+	float etaMin = params.eps / wMax;
+	lambda = params.epochs > 1 ? log(etaMax / etaMin) / (params.epochs - 1) : 0.f;
+}
+
+bool StressLayout::epoch(vector<Vector2f>& positions, const vector<bool>& pinned, float treshold)
+{
+	if (terms.empty() || t >= params.epochs)
+		return true;
+
+	float eta = etaMax * exp(-lambda * t);
+	// The order depends only on the seed and the epoch, so continuing from an earlier epoch repeats the run
+	rng.seed(params.seed + t);
+	shuffled.assign(terms.begin(), terms.end());
+	shuffle(shuffled.begin(), shuffled.end(), rng);
+	t++;
+
+	float maxMove = 0.f;
+	for (const Term& term : shuffled) {
+		Vector2f& pi = positions[term.i];
+		Vector2f& pj = positions[term.j];
+		Vector2f delta = pi - pj;
+		float dist = sqrt(delta.x * delta.x + delta.y * delta.y);
+		if (dist < 1e-4f) {
+			// coinciding nodes, push apart in a random direction
+			float angle = uniform_real_distribution<float>(0.f, 6.2831853f)(rng);
+			delta = { cos(angle), sin(angle) };
+			dist = 1.f;
+		}
+
+		float mu = min(term.w * eta, 1.f);
+		Vector2f r = delta * ((dist - term.d) / dist);
+
+		bool moveI = !pinned[term.i];
+		bool moveJ = !term.oneSided && !pinned[term.j];
+		// With one side fixed the whole correction goes to the other one
+		float share = (moveI && moveJ) ? mu / 2.f : mu;
+		Vector2f m = r * share;
+		if (moveI)
+			pi -= m;
+		if (moveJ)
+			pj += m;
+		if (moveI || moveJ)
+			maxMove = max(maxMove, max(abs(m.x), abs(m.y)));
+	}
+
+	return t >= params.epochs || maxMove < treshold;
+}
+
+void StressLayout::renumber(const vector<int>& rank)
+{
+	for (Term& term : terms) {
+		term.i = rank[term.i];
+		term.j = rank[term.j];
+	}
+}
+
+double normalizedStress(const vector<list<int>>& adjList, const vector<Vector2f>& positions, int exactUpTo, int samples, unsigned seed)
+{
+	int n = adjList.size();
+	vector<int> sources;
+	if (n <= exactUpTo) {
+		for (int i = 0; i < n; ++i)
+			sources.push_back(i);
+	}
+	else {
+		mt19937 rng(seed);
+		for (int s = 0; s < samples; ++s)
+			sources.push_back(uniform_int_distribution<int>(0, n - 1)(rng));
+	}
+
+	// stress(a) = sum w (a|X| - d)^2, optimal scale a = sum(w d |X|) / sum(w |X|^2)
+	// Sums of every source are kept apart and added in order, so the result doesn't depend on threads
+	struct Sums {
+		double wdx = 0., wxx = 0., wdd = 0., w = 0.;
+	};
+	vector<Sums> perSource(sources.size());
+	parallelFor(0, (int)sources.size(), [&](int s) {
+		int i = sources[s];
+		vector<int> dist;
+		bfsDistances(adjList, i, dist);
+		Sums& sums = perSource[s];
+		for (int j = 0; j < n; ++j) {
+			if (j == i || dist[j] <= 0)
+				continue;
+			double d = dist[j];
+			double w = 1. / (d * d);
+			Vector2f delta = positions[i] - positions[j];
+			double x = sqrt(double(delta.x) * delta.x + double(delta.y) * delta.y);
+			sums.wdx += w * d * x;
+			sums.wxx += w * x * x;
+			sums.wdd += w * d * d;
+			sums.w += w;
+		}
+	}, 1);
+
+	double sumWDX = 0., sumWXX = 0., sumWDD = 0., sumW = 0.;
+	for (const Sums& sums : perSource) {
+		sumWDX += sums.wdx;
+		sumWXX += sums.wxx;
+		sumWDD += sums.wdd;
+		sumW += sums.w;
+	}
+	if (sumW == 0. || sumWXX == 0.)
+		return 0.;
+
+	double a = sumWDX / sumWXX;
+	// sum w (a x - d)^2 expanded
+	double stress = a * a * sumWXX - 2 * a * sumWDX + sumWDD;
+	return stress / sumW;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <random>
+#include <SFML/System/Vector2.hpp>
+
+using namespace std;
+using namespace sf;
+
+struct StressParams {
+	// number of epochs, the step size anneals from 1/w_min to eps/w_max over them
+	int epochs = 30;
+	float eps = 0.1f;
+	// graphs with more nodes use the sparse pivot approximation instead of all pairs
+	int sparseFrom = 2000;
+	// pivots used by the sparse approximation
+	int pivots = 200;
+	unsigned seed = 0;
+};
+
+/* Stress layout by stochastic gradient descent (Zheng, Pawar & Goodman, 2018)
+*
+* Minimizes stress = sum w_ij (|X_i - X_j| - d_ij)^2, d_ij being graph distance times the ideal edge length
+* and w_ij = d_ij^-2. Every epoch visits all terms in random order and moves both ends of a term
+* towards its ideal distance.
+* Large graphs use the sparse approximation: exact terms for edges plus terms from every node to
+* a set of max-min pivots, weighted by how many nodes a pivot stands for (Ortmann et al.),
+* so memory and time per epoch are O(m + n * pivots) instead of O(n^2).
+*/
+class StressLayout
+{
+public:
+	StressLayout(StressParams params = StressParams()) : params(params) {}
+
+	// Compute distances and terms, l - ideal edge length
+	void init(const vector<list<int>>& adjList, float l);
+	// Run one epoch, returns true when the last epoch is done or nodes stopped moving
+	// pinned nodes are not moved
+	bool epoch(vector<Vector2f>& positions, const vector<bool>& pinned, float treshold);
+	// Nodes were renumbered, node i is now rank[i]
+	void renumber(const vector<int>& rank);
+	// Start annealing again from the first epoch
+	void restart() { t = 0; }
+	// Continue annealing from epoch 'epoch', used when going back in the history
+	void setEpoch(int epoch) { t = epoch; }
+	int epochsDone() const { return t; }
+private:
+	struct Term {
+		int i, j;
+		float d, w;
+		// only i moves, j is a pivot standing for its region
+		bool oneSided;
+	};
+
+	StressParams params;
+	vector<Term> terms;
+	// Terms in the order of the current epoch
+	vector<Term> shuffled;
+	float etaMax = 1.f, lambda = 0.f;
+	int t = 0;
+	mt19937 rng;
+};
+
+// Breadth-first distances from source, -1 for unreachable nodes
+void bfsDistances(const vector<list<int>>& adjList, int source, vector<int>& dist);
+
+// Stress of a layout after optimal uniform scaling, divided by the sum of weights
+// Exact for graphs up to 'exactUpTo' nodes, otherwise estimated from BFS of 'samples' random sources
+double normalizedStress(const vector<list<int>>& adjList, const vector<Vector2f>& positions, int exactUpTo = 3000, int samples = 200, unsigned seed = 0);
@@ -0,0 +1,247 @@
+#include "ThreadPool.hpp"
+#include "Parallel.hpp"
+
+// Index of the pool worker running on this thread, -1 on other threads
+static thread_local int workerIndex = -1;
+static thread_local ThreadPool* workerPool = nullptr;
+
+int ThreadPool::globalThreads = 0;
+
+ThreadPool::ThreadPool(int threads)
+{
+	threads = max(1, threads);
+	for (int i = 0; i < threads; ++i)
+		queues.emplace_back(new Queue());
+	for (int i = 0; i < threads; ++i)
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& t : workers)
+		t.join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+	static ThreadPool pool(globalThreads > 0 ? globalThreads : numWorkers());
+	return pool;
+}
+
+void ThreadPool::configureGlobal(int threads)
+{
+	globalThreads = threads;
+}
+
+void ThreadPool::TaskQueue::push_back(Task&& task)
+{
+	if (count == slots.size()) {
+		// Grow to the next power of two, unrolling the ring to the front
+		vector<Task> bigger(max<size_t>(16, slots.size() * 2));
+		for (size_t i = 0; i < count; ++i)
+			bigger[i] = move(slots[(head + i) & mask()]);
+		slots.swap(bigger);
+		head = 0;
+	}
+	slots[(head + count) & mask()] = move(task);
+	count++;
+}
+
+ThreadPool::Task ThreadPool::TaskQueue::pop_back()
+{
+	count--;
+	Task& slot = slots[(head + count) & mask()];
+	Task task = move(slot);
+	slot.run = nullptr;
+	return task;
+}
+
+ThreadPool::Task ThreadPool::TaskQueue::pop_front()
+{
+	Task& slot = slots[head];
+	Task task = move(slot);
+	slot.run = nullptr;
+	head = (head + 1) & mask();
+	count--;
+	return task;
+}
+
+bool ThreadPool::TaskQueue::take_group(const TaskGroup* group, Task& task)
+{
+	// Tasks of a waiting group were usually pushed last, so search from the back
+	for (size_t i = count; i-- > 0;) {
+		if (slots[(head + i) & mask()].group != group)
+			continue;
+		task = move(slots[(head + i) & mask()]);
+		// Close the gap, moving the tasks behind it doesn't allocate
+		for (size_t j = i + 1; j < count; ++j)
+			slots[(head + j - 1) & mask()] = move(slots[(head + j) & mask()]);
+		count--;
+		slots[(head + count) & mask()].run = nullptr;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::submit(function<void()> task)
+{
+	push({ move(task), nullptr });
+}
+
+void ThreadPool::push(Task task)
+{
+	int index = (workerPool == this) ? workerIndex : int(nextQueue++ % queues.size());
+	{
+		lock_guard<mutex> lock(queues[index]->m);
+		queues[index]->tasks.push_back(move(task));
+	}
+	queued++;
+	{
+		// Taking the lock orders the notify after a worker's check of 'queued'
+		lock_guard<mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+	groupWake.notify_all();
+}
+
+bool ThreadPool::take(int index, Task& task)
+{
+	int n = queues.size();
+	if (index >= 0) {
+		Queue& own = *queues[index];
+		lock_guard<mutex> lock(own.m);
+		if (!own.tasks.empty()) {
+			task = own.tasks.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	int start = index >= 0 ? index + 1 : int(nextQueue % n);
+	for (int k = 0; k < n; ++k) {
+		Queue& victim = *queues[(start + k) % n];
+		lock_guard<mutex> lock(victim.m);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.pop_front();
+			queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::execute(Task& task)
+{
+	if (!task.group) {
+		task.run();
+		return;
+	}
+
+	// The group has to be told even if the task throws, its waiter would block forever otherwise
+	exception_ptr failure;
+	try {
+		task.run();
+	}
+	catch (...) {
+		failure = current_exception();
+	}
+	task.group->finish(failure);
+}
+
+bool ThreadPool::runPendingTask()
+{
+	Task task;
+	if (!take(workerPool == this ? workerIndex : -1, task))
+		return false;
+	execute(task);
+	return true;
+}
+
+bool ThreadPool::runTaskFor(const TaskGroup& group)
+{
+	if (workerPool == this)
+		return runPendingTask();
+
+	Task task;
+	bool found = false;
+	for (auto& q : queues) {
+		lock_guard<mutex> lock(q->m);
+		if (q->tasks.take_group(&group, task)) {
+			found = true;
+			break;
+		}
+	}
+	if (!found)
+		return false;
+	queued--;
+	execute(task);
+	return true;
+}
+
+void ThreadPool::workerLoop(int index)
+{
+	workerIndex = index;
+	workerPool = this;
+	while (true) {
+		Task task;
+		if (take(index, task)) {
+			execute(task);
+			continue;
+		}
+
+		unique_lock<mutex> lock(sleepMutex);
+		wake.wait(lock, [this] { return stopping || queued > 0; });
+		if (stopping && queued == 0)
+			return;
+	}
+}
+
+void TaskGroup::run(function<void()> task)
+{
+	pending++;
+	// The task is queued as is, wrapping it to count it down could need an allocation
+	pool.push({ move(task), this });
+}
+
+void TaskGroup::finish(exception_ptr failure)
+{
+	// The waiter may return and destroy the group as soon as 'pending' drops, keep the pool in a local
+	ThreadPool& p = pool;
+	// Under the sleep lock so a waiter can't miss the last task between its check and going to sleep
+	lock_guard<mutex> lock(p.sleepMutex);
+	if (failure && !error)
+		error = failure;
+	if (--pending == 0) {
+		p.wake.notify_all();
+		p.groupWake.notify_all();
+	}
+}
+
+void TaskGroup::join()
+{
+	bool worker = workerPool == &pool;
+	while (pending > 0) {
+		int seen = pool.queued;
+		if (pool.runTaskFor(*this))
+			continue;
+		// The remaining tasks run on other threads, sleep until they finish or more work is queued.
+		// Other threads may leave foreign tasks queued, they only wake for newly queued ones so they don't spin
+		unique_lock<mutex> lock(pool.sleepMutex);
+		(worker ? pool.wake : pool.groupWake).wait(lock, [&] { return pending == 0 || pool.queued > (worker ? 0 : seen); });
+	}
+}
+
+void TaskGroup::wait()
+{
+	join();
+	if (error) {
+		exception_ptr failure = error;
+		error = nullptr;
+		rethrow_exception(failure);
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+
+using namespace std;
+
+/* Work-stealing thread pool
+*
+* Every worker owns a deque (a growable ring buffer): it pushes and pops its own tasks at the back (LIFO, cache friendly)
+* while idle workers steal from the front of other deques. Tasks submitted from outside the pool
+* are spread round-robin over the deques.
+* Workers waiting for a TaskGroup run any queued task meanwhile, so tasks may wait on nested parallel work.
+* Other threads only run tasks of the group they wait for, a GUI thread waiting on a parallelFor never picks up
+* a long submitted job. Waiters sleep once there is nothing they may run.
+*/
+class TaskGroup;
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool(int threads);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Queue a task, tasks submitted from a worker go to its own deque
+	void submit(function<void()> task);
+	// Run one queued task on the calling thread, returns false if there was none
+	bool runPendingTask();
+	int size() const { return workers.size(); }
+
+	// Pool shared by the whole application, created on first use
+	static ThreadPool& global();
+	// Set the number of threads of the global pool, has no effect once it is created
+	static void configureGlobal(int threads);
+private:
+	friend class TaskGroup;
+
+	struct Task {
+		function<void()> run;
+		// TaskGroup the task belongs to, told once the task has run or thrown
+		TaskGroup* group = nullptr;
+	};
+
+	// Double-ended ring of tasks, keeps its storage so steady submitting doesn't allocate
+	class TaskQueue {
+	public:
+		bool empty() const { return count == 0; }
+		void push_back(Task&& task);
+		Task pop_back();
+		Task pop_front();
+		// Remove the task of 'group' nearest to the back, returns false if there is none
+		bool take_group(const TaskGroup* group, Task& task);
+	private:
+		size_t mask() const { return slots.size() - 1; }
+		vector<Task> slots;
+		size_t head = 0, count = 0;
+	};
+
+	struct Queue {
+		mutex m;
+		TaskQueue tasks;
+	};
+
+	void push(Task task);
+	void workerLoop(int index);
+	// Pop from own deque, otherwise steal from the others
+	bool take(int index, Task& task);
+	// Run one task for a thread waiting on 'group', only workers may run tasks of other groups
+	bool runTaskFor(const TaskGroup& group);
+	static void execute(Task& task);
+
+	vector<unique_ptr<Queue>> queues;
+	vector<thread> workers;
+	atomic<bool> stopping{ false };
+	atomic<int> queued{ 0 };
+	atomic<unsigned> nextQueue{ 0 };
+	// Guards sleeping, idle workers and workers waiting for a TaskGroup wait on 'wake'
+	mutex sleepMutex;
+	condition_variable wake;
+	// Other threads waiting for a TaskGroup, apart so a push never wakes one of them instead of a worker
+	condition_variable groupWake;
+
+	static int globalThreads;
+};
+
+// Set of tasks that can be waited on together
+class TaskGroup
+{
+public:
+	explicit TaskGroup(ThreadPool& pool = ThreadPool::global()) : pool(pool) {}
+	// Waits for the tasks, an exception nobody waited for is dropped
+	~TaskGroup() { join(); }
+
+	void run(function<void()> task);
+	// Block until all tasks of the group are done, running queued tasks meanwhile
+	// Rethrows the first exception thrown by a task
+	void wait();
+private:
+	friend class ThreadPool;
+
+	void join();
+	// Called by the pool once a task has run, 'failure' is set if it threw
+	void finish(exception_ptr failure);
+
+	ThreadPool& pool;
+	atomic<int> pending{ 0 };
+	exception_ptr error;
+};
@@ -0,0 +1,157 @@
+#include <string>
+#include <vector>
+#include <exception>
+
+#include "TinyGraphViz.h"
+#include "Graph.hpp"
+#include "Util.hpp"
+
+using namespace std;
+
+struct tgv_graph {
+	Graph graph;
+};
+
+static thread_local string lastError;
+
+static void setError(const string& message) {
+	lastError = message;
+}
+
+tgv_graph* tgv_create(int num_nodes, int num_edges, const int* sources, const int* targets, const float* weights)
+{
+	lastError.clear();
+	if (num_nodes <= 0 || num_edges < 0 || (num_edges > 0 && (sources == nullptr || targets == nullptr))) {
+		setError("invalid graph size or missing edge arrays");
+		return nullptr;
+	}
+
+	vector<Node> nodes;
+	nodes.reserve(num_nodes);
+	for (int i = 0; i < num_nodes; ++i)
+		nodes.emplace_back(Node::from_id(i));
+
+	vector<Edge> edges;
+	edges.reserve(num_edges);
+	for (int i = 0; i < num_edges; ++i) {
+		if (sources[i] < 0 || sources[i] >= num_nodes || targets[i] < 0 || targets[i] >= num_nodes) {
+			setError("edge " + to_string(i) + " references a node out of range");
+			return nullptr;
+		}
+		edges.emplace_back(sources[i], targets[i], weights ? weights[i] : 1.f);
+	}
+
+	try {
+		tgv_graph* g = new tgv_graph{ Graph(nodes, edges) };
+		g->graph.FruchtermanReingold(calcFruchtParams(num_nodes));
+		return g;
+	}
+	catch (const exception& e) {
+		setError(e.what());
+		return nullptr;
+	}
+}
+
+void tgv_destroy(tgv_graph* graph)
+{
+	delete graph;
+}
+
+int tgv_num_nodes(const tgv_graph* graph)
+{
+	return graph->graph.Nodes().size();
+}
+
+int tgv_num_edges(const tgv_graph* graph)
+{
+	return graph->graph.Edges().size();
+}
+
+int tgv_set_algorithm(tgv_graph* graph, int algorithm, float C)
+{
+	FruchtermanParams params = calcFruchtParams(graph->graph.Nodes().size(), C);
+	switch (algorithm) {
+	case TGV_FRUCHTERMAN_REINGOLD:
+		graph->graph.FruchtermanReingold(params);
+		return 0;
+	case TGV_LINLOG:
+		graph->graph.LinLog(params);
+		return 0;
+	case TGV_FORCEATLAS2:
+		graph->graph.ForceAtlas2(params);
+		return 0;
+	case TGV_STRESS_SGD:
+		graph->graph.StressSGD(params);
+		return 0;
+	case TGV_TREE:
+	case TGV_RADIAL_TREE:
+		graph->graph.Tree(params, algorithm == TGV_RADIAL_TREE);
+		return 0;
+	case TGV_LAYERED:
+		graph->graph.Layered(params);
+		return 0;
+	default:
+		setError("unknown algorithm " + to_string(algorithm));
+		return -1;
+	}
+}
+
+void tgv_set_use_weights(tgv_graph* graph, int use_weights)
+{
+	graph->graph.setUseWeights(use_weights != 0);
+}
+
+void tgv_random_layout(tgv_graph* graph, unsigned seed)
+{
+	graph->graph.setSeed(seed);
+	graph->graph.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
+	graph->graph.Reset();
+}
+
+int tgv_step(tgv_graph* graph, int iterations)
+{
+	try {
+		bool running = true;
+		for (int i = 0; i < iterations && running; ++i)
+			running = graph->graph.Update();
+		return running ? 1 : 0;
+	}
+	catch (const exception& e) {
+		setError(e.what());
+		return -1;
+	}
+}
+
+int tgv_run(tgv_graph* graph, int max_iterations, tgv_progress_fn progress, void* user, int every)
+{
+	try {
+		int n = graph->graph.Nodes().size();
+		const float* positions = graph->graph.PositionBuffer();
+		int i = 0;
+		while (i < max_iterations) {
+			bool running = graph->graph.Update();
+			i++;
+			if (progress && every > 0 && (i % every == 0 || !running)) {
+				if (progress(i, positions, n, user) != 0)
+					break;
+			}
+			if (!running)
+				break;
+		}
+		return i;
+	}
+	catch (const exception& e) {
+		setError(e.what());
+		return -1;
+	}
+}
+
+float* tgv_positions(tgv_graph* graph)
+{
+	return graph->graph.PositionBuffer();
+}
+
+const char* tgv_last_error(void)
+{
+	return lastError.c_str();
+}
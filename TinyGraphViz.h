@@ -0,0 +1,79 @@
+#pragma once
+
+/* C API of the TinyGraphViz layout core
+*
+* Built as a shared library (TinyGraphVizLib.vcxproj), usable from any language with a C FFI.
+* Typical use:
+*   tgv_graph* g = tgv_create(n, m, sources, targets, NULL);
+*   tgv_set_algorithm(g, TGV_FRUCHTERMAN_REINGOLD, 0.7f);
+*   tgv_random_layout(g, 42);
+*   tgv_run(g, 10000, callback, user, 10);
+*   const float* xy = tgv_positions(g);  // x0, y0, x1, y1, ...
+*   tgv_destroy(g);
+*/
+
+#ifdef _WIN32
+#ifdef TGV_BUILD_DLL
+#define TGV_API __declspec(dllexport)
+#else
+#define TGV_API __declspec(dllimport)
+#endif
+#else
+#define TGV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tgv_graph tgv_graph;
+
+enum tgv_algorithm {
+	TGV_FRUCHTERMAN_REINGOLD = 0,
+	TGV_LINLOG = 1,
+	TGV_FORCEATLAS2 = 2,
+	TGV_STRESS_SGD = 3,
+	TGV_TREE = 4,
+	TGV_RADIAL_TREE = 5,
+	// layers from sources to targets, for directed graphs
+	TGV_LAYERED = 6
+};
+
+// Called during tgv_run, positions point into the engine's own buffer (2 * num_nodes floats).
+// Return nonzero to stop the run.
+typedef int (*tgv_progress_fn)(int iteration, const float* positions, int num_nodes, void* user);
+
+// Create a graph with nodes 0..num_nodes-1 and edges sources[i] - targets[i].
+// The arrays are only read during the call, weights may be NULL (all 1).
+// Returns NULL on invalid input, see tgv_last_error().
+TGV_API tgv_graph* tgv_create(int num_nodes, int num_edges, const int* sources, const int* targets, const float* weights);
+TGV_API void tgv_destroy(tgv_graph* graph);
+
+TGV_API int tgv_num_nodes(const tgv_graph* graph);
+TGV_API int tgv_num_edges(const tgv_graph* graph);
+
+// Select the algorithm, C scales the ideal edge length (0.7 by default in the GUI)
+// Returns 0 on success
+TGV_API int tgv_set_algorithm(tgv_graph* graph, int algorithm, float C);
+// Scale attraction by edge weight
+TGV_API void tgv_set_use_weights(tgv_graph* graph, int use_weights);
+// Place nodes randomly on a circle in the middle of the canvas, the same seed gives the same layout
+TGV_API void tgv_random_layout(tgv_graph* graph, unsigned seed);
+
+// Run up to 'iterations' steps, returns 1 while the layout is still running, 0 once it converged, -1 on error
+TGV_API int tgv_step(tgv_graph* graph, int iterations);
+// Run until convergence or max_iterations, calling progress every 'every' iterations (may be NULL)
+// Returns number of iterations run, -1 on error
+TGV_API int tgv_run(tgv_graph* graph, int max_iterations, tgv_progress_fn progress, void* user, int every);
+
+// Pointer to the node positions, interleaved x, y (2 * num_nodes floats).
+// The buffer is updated in place by every step and stays valid until tgv_destroy.
+// Writing to it sets the positions used by the next step.
+TGV_API float* tgv_positions(tgv_graph* graph);
+
+// Message of the last error on this thread, empty string if none
+TGV_API const char* tgv_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,349 @@
+#include <cmath>
+#include <algorithm>
+
+#include "TreeLayout.hpp"
+
+const double TREE_PI = 3.14159265358979323846;
+// Minimal distance between neighbouring nodes on a level
+const double SIBLING_DISTANCE = 1.;
+
+// Adjacency lists copied into one array, BFS over linked lists is dominated by cache misses
+struct Csr {
+	vector<int> start, neighbours;
+
+	Csr(const vector<list<int>>& adjList) {
+		start.resize(adjList.size() + 1, 0);
+		for (int v = 0; v < adjList.size(); ++v)
+			start[v + 1] = start[v] + adjList[v].size();
+		neighbours.reserve(start.back());
+		for (const list<int>& l : adjList)
+			neighbours.insert(neighbours.end(), l.begin(), l.end());
+	}
+};
+
+bool isForest(int n, const vector<Edge>& edges)
+{
+	// A forest has at most n - 1 edges
+	if (edges.size() >= (size_t)max(n, 1))
+		return false;
+
+	// A forest has exactly n - components edges, count components with union-find
+	vector<int> root(n);
+	for (int v = 0; v < n; ++v)
+		root[v] = v;
+	auto find = [&](int v) {
+		while (root[v] != v)
+			v = root[v] = root[root[v]];
+		return v;
+	};
+	size_t components = n;
+	for (const Edge& e : edges) {
+		int a = find(e[0]), b = find(e[1]);
+		if (a != b) {
+			root[a] = b;
+			components--;
+		}
+	}
+	return edges.size() == n - components;
+}
+
+// BFS from source over unvisited nodes, fills order, dist and parent, returns the last node reached
+static int bfs(const Csr& adj, int source, vector<int>& order, vector<int>& dist, vector<int>& parent, int stamp, vector<int>& seen)
+{
+	order.clear();
+	order.push_back(source);
+	seen[source] = stamp;
+	dist[source] = 0;
+	parent[source] = -1;
+	for (size_t head = 0; head < order.size(); ++head) {
+		int u = order[head];
+		for (int k = adj.start[u]; k < adj.start[u + 1]; ++k) {
+			int v = adj.neighbours[k];
+			if (seen[v] != stamp) {
+				seen[v] = stamp;
+				dist[v] = dist[u] + 1;
+				parent[v] = u;
+				order.push_back(v);
+			}
+		}
+	}
+	return order.back();
+}
+
+RootedForest spanningForest(const vector<list<int>>& adjList)
+{
+	int n = adjList.size();
+	Csr adj(adjList);
+	RootedForest forest;
+	forest.parent.assign(n, -1);
+	forest.depth.assign(n, 0);
+
+	vector<int> order, dist(n), parent(n), seen(n, 0);
+	vector<bool> done(n, false);
+	forest.order.reserve(n);
+	int stamp = 0;
+
+	for (int s = 0; s < n; ++s) {
+		if (done[s])
+			continue;
+		// Double sweep: a is an end of a longest path, b the other end, the center is halfway from b to a
+		int a = bfs(adj, s, order, dist, parent, ++stamp, seen);
+		int b = bfs(adj, a, order, dist, parent, ++stamp, seen);
+		int center = b;
+		for (int k = 0; k < dist[b] / 2; ++k)
+			center = parent[center];
+
+		bfs(adj, center, order, dist, forest.parent, ++stamp, seen);
+		forest.roots.push_back(center);
+		for (int v : order) {
+			done[v] = true;
+			forest.depth[v] = dist[v];
+			forest.order.push_back(v);
+		}
+	}
+
+	// Children in BFS order, which follows the adjacency order of the parent
+	forest.childStart.assign(n + 1, 0);
+	for (int v = 0; v < n; ++v) {
+		if (forest.parent[v] != -1)
+			forest.childStart[forest.parent[v] + 1]++;
+	}
+	for (int v = 0; v < n; ++v)
+		forest.childStart[v + 1] += forest.childStart[v];
+	forest.children.resize(forest.childStart[n]);
+	vector<int> fill(forest.childStart.begin(), forest.childStart.end() - 1);
+	for (int v : forest.order) {
+		if (forest.parent[v] != -1)
+			forest.children[fill[forest.parent[v]]++] = v;
+	}
+	return forest;
+}
+
+// State of the Buchheim-Walker algorithm, names follow the paper
+class Walker
+{
+public:
+	Walker(const RootedForest& forest) : f(forest) {
+		int n = f.size();
+		prelim.assign(n, 0.);
+		mod.assign(n, 0.);
+		shift.assign(n, 0.);
+		change.assign(n, 0.);
+		thread.assign(n, -1);
+		ancestor.resize(n);
+		for (int v = 0; v < n; ++v)
+			ancestor[v] = v;
+		number.assign(n, 0);
+		leftSibling.assign(n, -1);
+		for (int v = 0; v < n; ++v) {
+			for (int k = f.childStart[v]; k < f.childStart[v + 1]; ++k) {
+				int c = f.children[k];
+				number[c] = k - f.childStart[v];
+				if (k > f.childStart[v])
+					leftSibling[c] = f.children[k - 1];
+			}
+		}
+		defaultAncestor.assign(n, -1);
+	}
+
+	// First walk of the tree rooted at 'root' in post order, without recursion
+	void firstWalk(int root) {
+		// (node, index of the next child to visit)
+		vector<pair<int, int>> stack = { { root, 0 } };
+		while (!stack.empty()) {
+			auto& [v, next] = stack.back();
+			if (next < f.childCount(v)) {
+				int c = f.children[f.childStart[v] + next];
+				next++;
+				stack.push_back({ c, 0 });
+				continue;
+			}
+			int done = v;
+			stack.pop_back();
+			finish(done);
+			if (!stack.empty()) {
+				int p = stack.back().first;
+				if (defaultAncestor[p] == -1)
+					defaultAncestor[p] = f.firstChild(p);
+				defaultAncestor[p] = apportion(done, defaultAncestor[p]);
+			}
+		}
+	}
+
+	// Second walk, x = prelim + sum of modifiers of all ancestors
+	void secondWalk(int root, vector<double>& x, vector<int>& order) const {
+		order.clear();
+		order.push_back(root);
+		vector<double> sums = { 0. };
+		for (size_t head = 0; head < order.size(); ++head) {
+			int v = order[head];
+			double m = sums[head];
+			x[v] = prelim[v] + m;
+			for (int k = f.childStart[v]; k < f.childStart[v + 1]; ++k) {
+				order.push_back(f.children[k]);
+				sums.push_back(m + mod[v]);
+			}
+		}
+	}
+private:
+	// All children of v are placed, place v
+	void finish(int v) {
+		int w = leftSibling[v];
+		if (f.childCount(v) == 0) {
+			prelim[v] = w != -1 ? prelim[w] + SIBLING_DISTANCE : 0.;
+			return;
+		}
+		executeShifts(v);
+		double midpoint = (prelim[f.firstChild(v)] + prelim[f.lastChild(v)]) / 2;
+		if (w != -1) {
+			prelim[v] = prelim[w] + SIBLING_DISTANCE;
+			mod[v] = prelim[v] - midpoint;
+		}
+		else {
+			prelim[v] = midpoint;
+		}
+	}
+
+	int nextLeft(int v) const { return f.childCount(v) > 0 ? f.firstChild(v) : thread[v]; }
+	int nextRight(int v) const { return f.childCount(v) > 0 ? f.lastChild(v) : thread[v]; }
+
+	// Push the subtree of v right until its left contour clears the right contours of its left siblings
+	int apportion(int v, int defaultAnc) {
+		int w = leftSibling[v];
+		if (w == -1)
+			return defaultAnc;
+
+		int p = f.parent[v];
+		int vip = v, vop = v, vim = w, vom = f.firstChild(p);
+		double sip = mod[vip], sop = mod[vop], sim = mod[vim], som = mod[vom];
+		while (nextRight(vim) != -1 && nextLeft(vip) != -1) {
+			vim = nextRight(vim);
+			vip = nextLeft(vip);
+			vom = nextLeft(vom);
+			vop = nextRight(vop);
+			ancestor[vop] = v;
+			double s = (prelim[vim] + sim) - (prelim[vip] + sip) + SIBLING_DISTANCE;
+			if (s > 0) {
+				int a = f.parent[ancestor[vim]] == p ? ancestor[vim] : defaultAnc;
+				moveSubtree(a, v, s);
+				sip += s;
+				sop += s;
+			}
+			sim += mod[vim];
+			sip += mod[vip];
+			som += mod[vom];
+			sop += mod[vop];
+		}
+		if (nextRight(vim) != -1 && nextRight(vop) == -1) {
+			thread[vop] = nextRight(vim);
+			mod[vop] += sim - sop;
+		}
+		if (nextLeft(vip) != -1 && nextLeft(vom) == -1) {
+			thread[vom] = nextLeft(vip);
+			mod[vom] += sip - som;
+			defaultAnc = v;
+		}
+		return defaultAnc;
+	}
+
+	void moveSubtree(int wm, int wp, double s) {
+		double subtrees = number[wp] - number[wm];
+		change[wp] -= s / subtrees;
+		shift[wp] += s;
+		change[wm] += s / subtrees;
+		prelim[wp] += s;
+		mod[wp] += s;
+	}
+
+	// Apply the shifts collected by moveSubtree to the children of v, spacing smaller subtrees evenly
+	void executeShifts(int v) {
+		double s = 0., c = 0.;
+		for (int k = f.childStart[v + 1] - 1; k >= f.childStart[v]; --k) {
+			int w = f.children[k];
+			prelim[w] += s;
+			mod[w] += s;
+			c += change[w];
+			s += shift[w] + c;
+		}
+	}
+
+	const RootedForest& f;
+	vector<double> prelim, mod, shift, change;
+	vector<int> thread, ancestor, number, leftSibling, defaultAncestor;
+};
+
+vector<double> treeLayoutX(const RootedForest& forest)
+{
+	int n = forest.size();
+	// Renumber nodes in BFS order so the walks touch memory mostly in sequence
+	const vector<int>& order = forest.order;
+	vector<int> id(n);
+	for (int k = 0; k < n; ++k)
+		id[order[k]] = k;
+
+	RootedForest local;
+	local.parent.resize(n);
+	local.childStart.resize(n + 1);
+	local.children.resize(forest.children.size());
+	for (int root : forest.roots)
+		local.roots.push_back(id[root]);
+	int next = 0;
+	for (int k = 0; k < n; ++k) {
+		int v = order[k];
+		local.parent[k] = forest.parent[v] == -1 ? -1 : id[forest.parent[v]];
+		local.childStart[k] = next;
+		for (int c = forest.childStart[v]; c < forest.childStart[v + 1]; ++c)
+			local.children[next++] = id[forest.children[c]];
+	}
+	local.childStart[n] = next;
+
+	vector<double> localX(n, 0.);
+	Walker walker(local);
+	vector<int> tree;
+	double right = 0.;
+	for (int root : local.roots) {
+		walker.firstWalk(root);
+		walker.secondWalk(root, localX, tree);
+
+		// Put the tree right of the previous one
+		double minX = localX[root], maxX = localX[root];
+		for (int v : tree) {
+			minX = min(minX, localX[v]);
+			maxX = max(maxX, localX[v]);
+		}
+		double offset = (root == local.roots.front() ? 0. : right + SIBLING_DISTANCE) - minX;
+		for (int v : tree)
+			localX[v] += offset;
+		right = maxX + offset;
+	}
+
+	vector<double> x(n);
+	for (int k = 0; k < n; ++k)
+		x[order[k]] = localX[k];
+	return x;
+}
+
+void treeLayout(const RootedForest& forest, Vector2f center, Vector2f size, bool radial, vector<Vector2f>& positions)
+{
+	int n = forest.size();
+	if (n == 0)
+		return;
+	vector<double> x = treeLayoutX(forest);
+	double width = *max_element(x.begin(), x.end());
+	int height = *max_element(forest.depth.begin(), forest.depth.end());
+
+	for (int v = 0; v < n; ++v) {
+		if (radial) {
+			// Levels on concentric circles, x becomes the angle, one extra unit so the ends don't touch
+			float radius = min(size.x, size.y) / 2;
+			double angle = 2 * TREE_PI * x[v] / (width + SIBLING_DISTANCE);
+			float r = height > 0 ? radius * forest.depth[v] / height : 0.f;
+			positions[v] = { center.x + r * (float)cos(angle), center.y + r * (float)sin(angle) };
+		}
+		else {
+			float px = width > 0 ? (float)(x[v] / width) - 0.5f : 0.f;
+			float py = height > 0 ? forest.depth[v] / (float)height - 0.5f : 0.f;
+			positions[v] = { center.x + px * size.x, center.y + py * size.y };
+		}
+	}
+}
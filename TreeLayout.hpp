@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <SFML/System/Vector2.hpp>
+
+#include "Edge.hpp"
+
+using namespace std;
+using namespace sf;
+
+// Spanning forest of a graph, rooted at the center of every connected component
+struct RootedForest {
+	vector<int> roots;
+	vector<int> parent;
+	vector<int> depth;
+	// Children of v are children[childStart[v]] .. children[childStart[v+1]-1], in adjacency order
+	vector<int> childStart;
+	vector<int> children;
+	// Nodes tree by tree in BFS order from the root, parents before their children
+	vector<int> order;
+
+	int size() const { return parent.size(); }
+	int childCount(int v) const { return childStart[v + 1] - childStart[v]; }
+	int firstChild(int v) const { return children[childStart[v]]; }
+	int lastChild(int v) const { return children[childStart[v + 1] - 1]; }
+};
+
+// True if the graph with n nodes has no cycles (no self loops or parallel edges either)
+// Reads the edge array rather than adjacency lists, walking a million lists is mostly cache misses
+bool isForest(int n, const vector<Edge>& edges);
+
+// BFS spanning forest, every component is rooted at its center (middle of a longest BFS path)
+// so the tree is as shallow as possible. For a forest this is the forest itself.
+RootedForest spanningForest(const vector<list<int>>& adjList);
+
+/* Tree layout by Buchheim, Junger & Leipert (2002), the linear time version of Walker's algorithm
+*
+* Every node gets an x coordinate such that neighbouring nodes on a level are at least one unit apart,
+* parents are centered above their children and smaller subtrees between large ones are spaced evenly.
+* Trees of a forest are placed side by side. Iterative, so the depth of the tree doesn't matter.
+*/
+vector<double> treeLayoutX(const RootedForest& forest);
+
+// Layered tree layout of the forest fitted into the rectangle centered at 'center'
+// radial - levels are circles around the center instead of horizontal lines
+void treeLayout(const RootedForest& forest, Vector2f center, Vector2f size, bool radial, vector<Vector2f>& positions);
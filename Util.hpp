@@ -43,7 +43,11 @@ const float CANVAS_WIDTH = WINDOW_WIDTH - CANVAS_OFFSET.x;
 const float CANVAS_HEIGHT = WINDOW_HEIGHT - BOTTOM_BAR - CANVAS_OFFSET.y;
 const auto WINDOW_BG_COLOR = Color({ 120, 120, 120 });
 const auto CANVAS_BG_COLOR = Color({ 169, 169, 169 });
-extern float FRAMERATE;
+const unsigned FRAMERATE = 60;
+// Time per frame spent on layout steps
+const float FRAME_BUDGET_MS = 12.f;
+// Layout steps per second set by the speed slider, 0 for as many as fit in the frame budget
+extern float ITERATIONS_PER_SECOND;
 extern bool RUNNING;
 extern bool DONE;
 extern std::chrono::time_point<std::chrono::high_resolution_clock> timeStart;
@@ -63,31 +67,49 @@ inline void print_vector(const std::vector<T>& v) {
 	cout << "]" << endl;
 }
 
-inline float Euclidian(Vector2f p1, Vector2f p2);
+const float Eps = 0.001f;
+
+inline float Euclidian(Vector2f p1, Vector2f p2) {
+	float dx = p1.x - p2.x;
+	float dy = p1.y - p2.y;
+
+	float dist = sqrt(dx * dx + dy * dy);
+
+	return dist;
+}
 
 // Calculate repulsive force between two points
 // p1, p2 - points
 // l - ideal spring length for edges
 // f_rep = l^2 / |p1-p2|
-Vector2f repulsive(Vector2f p1, Vector2f p2, float l);
+inline Vector2f repulsive(Vector2f p1, Vector2f p2, float l) {
+	// Possible optimization, inverse square root
+	float dist = max(Euclidian(p1, p2), Eps);
+
+	// calculate unit vector from p2 to p1
+	Vector2f unit = Vector2f(p1.x - p2.x, p1.y - p2.y);
+	unit /= dist;
+
+	// l^2 / dist
+	float force = (l*l) / dist;
+	return unit * force;
+}
 
 // Calculate attractive force between two points
 // p1, p2 - points
 // l - ideal spring length for edges
 // f_attr = |p1-p2|^2 / l
-Vector2f attractive(Vector2f p1, Vector2f p2, float l);
-
-// Function to generate a random number between -A and A
-inline float generateRandomNumber(float A, float B) {
-	// Create a random number generator engine
-	std::random_device rd;
-	std::mt19937 gen(rd());
+inline Vector2f attractive(Vector2f p1, Vector2f p2, float l) {
+	// Possible optimization, inverse square root
+	float dist = max(Euclidian(p1, p2), Eps);
 
-	// Create a uniform distribution in the range [-A, A]
-	std::uniform_real_distribution<float> dis(A, B);
+	// unit vector from p1 to p2
+	Vector2f unit = Vector2f(p2.x - p1.x, p2.y - p1.y);
+	unit /= dist;
 
-	// Generate and return a random number
-	return dis(gen);
+	// dist^2 / l
+	float force = (dist*dist) / l;
+	return unit * force;
 }
 
 // trim from start (in place)
@@ -0,0 +1,67 @@
+"""Lay out a graph through the TinyGraphViz C API using ctypes.
+
+Usage: python layout.py <path to TinyGraphViz.dll / libTinyGraphViz.so> [seed]
+
+Positions are read through a ctypes array that aliases the engine's own
+buffer, so nothing is copied between steps.
+"""
+import ctypes
+import sys
+
+PROGRESS = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_float),
+                            ctypes.c_int, ctypes.c_void_p)
+
+TGV_FRUCHTERMAN_REINGOLD = 0
+
+
+def load(path):
+    lib = ctypes.CDLL(path)
+    lib.tgv_create.restype = ctypes.c_void_p
+    lib.tgv_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_int),
+                               ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_float)]
+    lib.tgv_destroy.argtypes = [ctypes.c_void_p]
+    lib.tgv_num_nodes.argtypes = [ctypes.c_void_p]
+    lib.tgv_set_algorithm.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_float]
+    lib.tgv_random_layout.argtypes = [ctypes.c_void_p, ctypes.c_uint]
+    lib.tgv_run.argtypes = [ctypes.c_void_p, ctypes.c_int, PROGRESS, ctypes.c_void_p, ctypes.c_int]
+    lib.tgv_positions.restype = ctypes.POINTER(ctypes.c_float)
+    lib.tgv_positions.argtypes = [ctypes.c_void_p]
+    lib.tgv_last_error.restype = ctypes.c_char_p
+    return lib
+
+
+def main():
+    lib = load(sys.argv[1])
+    seed = int(sys.argv[2]) if len(sys.argv) > 2 else 42
+
+    # K5 plus a tail
+    edges = [(i, j) for i in range(5) for j in range(i + 1, 5)] + [(4, 5), (5, 6)]
+    n = 7
+    sources = (ctypes.c_int * len(edges))(*[e[0] for e in edges])
+    targets = (ctypes.c_int * len(edges))(*[e[1] for e in edges])
+
+    graph = lib.tgv_create(n, len(edges), sources, targets, None)
+    if not graph:
+        raise RuntimeError(lib.tgv_last_error().decode())
+
+    lib.tgv_set_algorithm(graph, TGV_FRUCHTERMAN_REINGOLD, 0.7)
+    lib.tgv_random_layout(graph, seed)
+
+    @PROGRESS
+    def progress(iteration, positions, num_nodes, user):
+        print(f"iteration {iteration}: node 0 at ({positions[0]:.1f}, {positions[1]:.1f})")
+        return 0
+
+    iterations = lib.tgv_run(graph, 10000, progress, None, 100)
+
+    # View of the engine's buffer, valid until tgv_destroy
+    xy = ctypes.cast(lib.tgv_positions(graph), ctypes.POINTER(ctypes.c_float * (2 * n))).contents
+    print(f"converged after {iterations} iterations")
+    for i in range(n):
+        print(f"{i}: {xy[2 * i]:.1f} {xy[2 * i + 1]:.1f}")
+
+    lib.tgv_destroy(graph)
+
+
+if __name__ == "__main__":
+    main()
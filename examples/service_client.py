@@ -0,0 +1,59 @@
+"""Request a layout from a running TinyGraphViz layout service.
+
+Usage: python service_client.py <socket path | port> <edge list file> [algorithm]
+
+Start the service with `TinyGraphViz --serve /tmp/tinygraphviz.sock` (Unix
+domain socket) or `TinyGraphViz --serve --port 7473` (TCP on 127.0.0.1).
+"""
+import socket
+import struct
+import sys
+
+
+def connect(address):
+    if address.isdigit():
+        return socket.create_connection(("127.0.0.1", int(address)))
+    s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.connect(address)
+    return s
+
+
+def layout(sock, edges, algorithm="fr", frames=50):
+    """Yields (iteration, positions) for every frame, returns the DONE line."""
+    src = sock.makefile("rb")
+    sock.sendall(f"LAYOUT edgelist {len(edges)} algorithm={algorithm} frames={frames}\n".encode() + edges)
+    line = src.readline().decode().split()
+    if line[0] == "ERROR":
+        raise RuntimeError(" ".join(line[1:]))
+    labels = [src.readline().decode().rstrip("\n") for _ in range(int(line[1]))]
+    while True:
+        line = src.readline().decode().split()
+        if line[0] == "FRAME":
+            n = int(line[2])
+            xy = struct.unpack(f"<{2 * n}f", src.read(8 * n))
+            yield int(line[1]), dict(zip(labels, zip(xy[0::2], xy[1::2])))
+        elif line[0] == "ERROR":
+            raise RuntimeError(" ".join(line[1:]))
+        else:
+            return line
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return
+    with open(sys.argv[2], "rb") as f:
+        edges = f.read()
+    algorithm = sys.argv[3] if len(sys.argv) > 3 else "fr"
+    with connect(sys.argv[1]) as sock:
+        positions = {}
+        for iteration, positions in layout(sock, edges, algorithm):
+            print(f"iteration {iteration}")
+        for label, (x, y) in sorted(positions.items())[:10]:
+            print(f"{label}: {x:.1f} {y:.1f}")
+        sock.sendall(b"STATS\n")
+        print(sock.makefile("rb").readline().decode().strip())
+
+
+if __name__ == "__main__":
+    main()
@@ -13,6 +13,8 @@
 #include "Edge.hpp"
 #include "Graph.hpp"
 #include "Gui.hpp"
+#include "Cli.hpp"
+#include "StepScheduler.hpp"
 
 using namespace sf;
 using namespace std;
@@ -31,7 +33,12 @@ bool RUNNING = false;
 bool DONE = false;
 std::chrono::time_point<std::chrono::high_resolution_clock> timeStart;
 
-int main() {
+int main(int argc, char** argv) {
+    // Headless modes (batch etc.)
+    int exitCode = runCli(argc, argv);
+    if (exitCode != -1)
+        return exitCode;
+
     RenderWindow window(VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "GraphVisualizer", Style::Titlebar | Style::Close);
 
     // Position the window in the center of the screen
@@ -39,7 +46,12 @@ int main() {
     window.setPosition({ (int)(desktop.width / 2 - window.getSize().x / 2), (int)(desktop.height / 2 - window.getSize().y / 2 - 60) });
 
     window.setFramerateLimit(FRAMERATE);
-    auto currFramerate = FRAMERATE;
+
+    // Runs as many layout steps per frame as the budget and the speed slider allow
+    StepScheduler stepper(FRAME_BUDGET_MS);
+    auto currSpeed = ITERATIONS_PER_SECOND;
+    stepper.setTarget(currSpeed);
+    bool wasRunning = false;
 
     Font font;
     if (!font.loadFromFile("CourierPrime-Regular.ttf"))
@@ -58,51 +70,81 @@ int main() {
     Graph G = Graph::fromGML(ZACHARY_GML);
     DBG(G);
 
+    G.setRecordHistory(true);
+    G.setSeed(randomSeed());
     G.RandomCircularLayout(Vector2f(CANVAS_WIDTH / 2.f, CANVAS_HEIGHT / 2.f), CANVAS_HEIGHT * 0.40);
     params = calcFruchtParams(G.Nodes().size());
     G.FruchtermanReingold(params);
+    G.ComputeCentrality();
 
     GUI::initWidgets(gui, G);
 
+    auto handleEvent = [&](const Event& event) {
+        if (event.type == Event::Closed) {
+            cout << "Pressed exit" << endl;
+            window.close();
+        }
+
+        gui.handleEvent(event);
+        GUI::handleCanvasEvent(event, G);
+    };
+
     while (window.isOpen())
     {
+        // Nothing is moving and the canvas is up to date, sleep until the next event
+        // Background work (centrality, loading) can't wake waitEvent, so poll for it every few milliseconds instead
+        bool background = G.PollBackground();
+        // A graph loading in the background is swapped in here, between frames
+        background = GUI::pollLoading(gui, G) || background;
+        bool idle = !(!DEBUGGING && RUNNING) && !G.Settling() && !G.Dirty();
         Event event;
+        if (idle && background)
+            sf::sleep(sf::milliseconds(10));
+        else if (idle && window.waitEvent(event))
+            handleEvent(event);
         while (window.pollEvent(event))
-        {
-            if (event.type == Event::Closed) {
-                cout << "Pressed exit" << endl;
-                window.close();
-            }
+            handleEvent(event);
+        if (!window.isOpen())
+            break;
 
-            gui.handleEvent(event);
+        // Update
+        if (currSpeed != ITERATIONS_PER_SECOND) {
+            stepper.setTarget(ITERATIONS_PER_SECOND);
+            currSpeed = ITERATIONS_PER_SECOND;
         }
+        if (RUNNING && !wasRunning)
+            stepper.restart();
+        wasRunning = RUNNING;
 
-        // Update
         if (!DEBUGGING && RUNNING) {
-            if (!G.Update()) {
+            if (!stepper.run([&G]() { return G.Update(); })) {
                 // Simulation has ended
                 RUNNING = false;
                 GUI::updateWidgetsDone(gui);
+                GUI::cacheLayout(G);
                 auto timeEnd = chrono::high_resolution_clock::now();
                 auto duration = chrono::duration_cast<chrono::milliseconds>(timeEnd - timeStart);
                 cout << "Equillibrium reached in " << duration.count() << " milliseconds" << endl;
+                cout << "Heap allocations: " << G.StepAllocations() << " in the last step, " << G.FrameAllocations() << " in the last frame" << endl;
             }
         }
-
-        if (currFramerate != FRAMERATE) {
-            window.setFramerateLimit(FRAMERATE);
-            currFramerate = FRAMERATE;
+        else if (G.Settling()) {
+            // Converged layout adapting to a dragged node
+            G.Update();
         }
 
-        // Draw
-        window.clear(WINDOW_BG_COLOR);
+        GUI::updateHistory(gui, G);
 
-        canvas->clear(CANVAS_BG_COLOR);
-        G.draw(canvas, font);
-        canvas->display();
+        // Draw
+        // The canvas keeps its picture between frames, redraw the graph only when it changed
+        if (G.Dirty()) {
+            canvas->clear(CANVAS_BG_COLOR);
+            G.draw(canvas, font);
+            canvas->display();
+        }
 
+        window.clear(WINDOW_BG_COLOR);
         gui.draw();
-
         window.display();
     }
 